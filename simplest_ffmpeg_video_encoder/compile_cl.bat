@@ -5,6 +5,6 @@ call "D:\Program Files\Microsoft Visual Studio 10.0\VC\vcvarsall.bat"
 ::lib
 @set LIB=lib;%LIB%
 ::compile and link
-cl simplest_ffmpeg_video_encoder.cpp /link avcodec.lib avformat.lib avutil.lib ^
+cl simplest_ffmpeg_video_encoder.cpp /openmp /link avcodec.lib avformat.lib avutil.lib ^
 avdevice.lib avfilter.lib postproc.lib swresample.lib swscale.lib /OPT:NOREF
 exit
\ No newline at end of file
@@ -1,3 +1,3 @@
 #! /bin/sh
-gcc simplest_ffmpeg_video_encoder.cpp -g -o simplest_ffmpeg_video_encoder.out \
+gcc simplest_ffmpeg_video_encoder.cpp -g -fopenmp -o simplest_ffmpeg_video_encoder.out \
 -I /usr/local/include -L /usr/local/lib -lavformat -lavcodec -lavutil
\ No newline at end of file
@@ -17,6 +17,7 @@
  */
 
 #include <stdio.h>
+#include <limits.h>
 
 #define __STDC_CONSTANT_MACROS
 
@@ -27,6 +28,7 @@ extern "C"
 #include "libavutil/opt.h"
 #include "libavcodec/avcodec.h"
 #include "libavformat/avformat.h"
+#include "libavutil/pixdesc.h"
 };
 #else
 //Linux...
@@ -37,11 +39,41 @@ extern "C"
 #include <libavutil/opt.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <libavutil/pixdesc.h>
 #ifdef __cplusplus
 };
 #endif
 #endif
 
+#include "y4m_reader.h"
+#include "timecode_reader.h"
+
+//frame offsets of long clips do not fit in a 32-bit long
+#ifdef _WIN32
+#define segment_seek _fseeki64
+#else
+#define segment_seek fseeko
+#endif
+
+/*
+ * Fast-start mode
+ *
+ * 	The first FAST_START_SECONDS are encoded with a fast preset on a
+ * 	second codec context, in parallel with the main context which
+ * 	encodes the rest with the quality preset. The main part opens
+ * 	with an IDR and the fast part is fully flushed, so the two join
+ * 	at a closed GOP boundary. SPS/PPS are sent in-band by both parts
+ * 	(CODEC_FLAG_GLOBAL_HEADER is not set), so the output needs an
+ * 	Annex B container such as raw .h264 or .ts.
+ *
+ * 	Fast packets are muxed as soon as they come out, so the opening
+ * 	segment is playable early. Main packets are held back only until
+ * 	the fast part is complete; from then on the held ones are muxed
+ * 	and the rest goes out as it comes.
+ */
+#define FAST_START          0
+#define FAST_START_SECONDS  4
+
 
 int flush_encoder(AVFormatContext *fmt_ctx,unsigned int stream_index){
 	int ret;
@@ -64,6 +96,10 @@ int flush_encoder(AVFormatContext *fmt_ctx,unsigned int stream_index){
 			break;
 		}
 		printf("Flush Encoder: Succeed to encode 1 frame!\tsize:%5d\n",enc_pkt.size);
+		//pts and dts come out in the codec's time base
+		enc_pkt.stream_index = stream_index;
+		av_packet_rescale_ts(&enc_pkt, fmt_ctx->streams[stream_index]->codec->time_base,
+			fmt_ctx->streams[stream_index]->time_base);
 		/* mux encoded frame */
 		ret = av_write_frame(fmt_ctx, &enc_pkt);
 		if (ret < 0)
@@ -72,6 +108,109 @@ int flush_encoder(AVFormatContext *fmt_ctx,unsigned int stream_index){
 	return ret;
 }
 
+#if FAST_START
+/*
+ * Main part packets that are waiting for the fast part. fast_done and
+ * the packets are shared by both sections, under omp critical(fast_start).
+ */
+struct HeldPackets{
+	AVPacket *pkts;
+	int nb;
+	int fast_done;	// the fast part is flushed and muxed
+	int fast_ret;
+};
+
+//Mux the held packets while ret >= 0 and free them all
+int release_held(AVFormatContext *fmt_ctx, HeldPackets *hold, int ret){
+	for (int k = 0; k < hold->nb; k++){
+		if (ret >= 0)
+			ret = av_write_frame(fmt_ctx, &hold->pkts[k]);
+		av_free_packet(&hold->pkts[k]);
+	}
+	av_freep(&hold->pkts);
+	hold->nb = 0;
+	return ret;
+}
+
+/*
+ * Encode frames [first, first+count) of in_file with ctx, then flush ctx.
+ * Packets are muxed right away, or, when hold is set, held until the
+ * fast part is done and then muxed with the ones after them.
+ * y4m describes in_file if it is a .y4m file, NULL for raw YUV; tc
+ * times the frames if set, otherwise they are 1/fps apart.
+ */
+int encode_segment(AVFormatContext *fmt_ctx, AVStream *st, AVCodecContext *ctx,
+	FILE *in_file, const Y4MInfo *y4m, const TimecodeInfo *tc, int first, int count, HeldPackets *hold){
+	const char *name = hold ? "Main" : "Fast";
+	int picture_size = avpicture_get_size(ctx->pix_fmt, ctx->width, ctx->height);
+	uint8_t *picture_buf = (uint8_t *)av_malloc(picture_size);
+	AVFrame *frame = av_frame_alloc();
+	AVPacket pkt;
+	int ret = 0;
+	int framecnt = 0;
+	int got_picture;
+	avpicture_fill((AVPicture *)frame, picture_buf, ctx->pix_fmt, ctx->width, ctx->height);
+
+	if (y4m)
+		segment_seek(in_file, y4m_frame_offset(y4m, first), SEEK_SET);
+	else
+		segment_seek(in_file, (int64_t)first * picture_size, SEEK_SET);
+	for (int i = first; ; i++){
+		AVFrame *in = NULL;
+		if (i < first + count){
+			if ((y4m && y4m_read_frame_header(in_file) < 0) ||
+				fread(picture_buf, 1, picture_size, in_file) != (size_t)picture_size){
+				count = i - first;	// input ended early, flush from here
+			}else{
+				frame->pts = tc ? timecode_pts(tc, i) : i;
+				in = frame;
+			}
+		}
+		pkt.data = NULL;
+		pkt.size = 0;
+		av_init_packet(&pkt);
+		ret = avcodec_encode_video2(ctx, &pkt, in, &got_picture);
+		if (ret < 0){
+			printf("%s: Failed to encode! \n", name);
+			break;
+		}
+		if (!got_picture){
+			if (!in)
+				break;	// fully flushed
+			continue;
+		}
+		printf("%s: Succeed to encode frame: %5d\tsize:%5d\n", name, framecnt++, pkt.size);
+		pkt.stream_index = st->index;
+		av_packet_rescale_ts(&pkt, ctx->time_base, st->time_base);
+		if (hold){
+			int streaming;
+#pragma omp critical(fast_start)
+			{
+				streaming = hold->fast_done;
+				if (!streaming)
+					av_dynarray2_add((void **)&hold->pkts, &hold->nb, sizeof(pkt), (const uint8_t *)&pkt);
+			}
+			if (!streaming)
+				continue;
+			//the fast part is out, so only this section writes now
+			ret = release_held(fmt_ctx, hold, hold->fast_ret);
+			if (ret < 0){
+				av_free_packet(&pkt);
+				break;
+			}
+		}
+		ret = av_write_frame(fmt_ctx, &pkt);
+		av_free_packet(&pkt);
+		if (ret < 0)
+			break;
+	}
+
+	av_frame_free(&frame);
+	av_free(picture_buf);
+	return ret;
+}
+#endif
+
 int main(int argc, char* argv[])
 {
 	AVFormatContext* pFormatCtx;
@@ -83,17 +222,60 @@ int main(int argc, char* argv[])
 	uint8_t* picture_buf;
 	AVFrame* pFrame;
 	int picture_size;
-	int y_size;
 	int framecnt=0;
-	//FILE *in_file = fopen("src01_480x272.yuv", "rb");	//Input raw YUV data 
-	FILE *in_file = fopen("../ds_480x272.yuv", "rb");   //Input raw YUV data
+	//const char* in_path = "src01_480x272.yuv";
+	const char* in_path = "../ds_480x272.yuv";         //Input raw YUV data, or .y4m
 	int in_w=480,in_h=272;                              //Input data's width and height
+	AVPixelFormat in_fmt = AV_PIX_FMT_YUV420P;          //Input raw YUV layout: YUV420P, YUV422P or YUV444P
 	int framenum=100;                                   //Frames to encode
+	AVRational fps = {25, 1};                           //Input frame rate
 	//const char* out_file = "src01.h264";              //Output Filepath 
 	//const char* out_file = "src01.ts";
 	//const char* out_file = "src01.hevc";
 	const char* out_file = "ds.h264";
 
+	//Usage: simplest_ffmpeg_video_encoder [input [output [timecodes]]]
+	if (argc > 1)
+		in_path = argv[1];
+	if (argc > 2)
+		out_file = argv[2];
+	FILE *in_file = fopen(in_path, "rb");
+	if (!in_file){
+		printf("Failed to open input file! \n");
+		return -1;
+	}
+	//A .y4m file carries its own size and frame rate, and ends at EOF
+	Y4MInfo y4m;
+	const Y4MInfo *in_y4m = NULL;
+	if (y4m_is_y4m(in_path)){
+		if (y4m_read_header(in_file, &y4m) < 0){
+			printf("Failed to read y4m header! \n");
+			return -1;
+		}
+		if (y4m.pix_fmt == AV_PIX_FMT_GRAY8){
+			printf("Monochrome y4m input is not supported! \n");
+			return -1;
+		}
+		in_fmt = y4m.pix_fmt;
+		in_w = y4m.width;
+		in_h = y4m.height;
+		fps = y4m.fps;
+		framenum = INT_MAX;
+		in_y4m = &y4m;
+		printf("Y4M input: %dx%d, %d/%d fps, %s\n", in_w, in_h, fps.num, fps.den, av_get_pix_fmt_name(in_fmt));
+	}
+	//Variable frame rate: a timecode v2 file gives every frame its time
+	TimecodeInfo tc;
+	const TimecodeInfo *in_tc = NULL;
+	if (argc > 3){
+		if (timecode_read(argv[3], &tc) < 0){
+			printf("Failed to read timecode v2 file! \n");
+			return -1;
+		}
+		in_tc = &tc;
+		printf("Timecodes: %d frames, time base 1/%d\n", tc.count, tc.time_base.den);
+	}
+
 	av_register_all();
 	//Method1.
 	pFormatCtx = avformat_alloc_context();
@@ -124,14 +306,21 @@ int main(int argc, char* argv[])
 	//pCodecCtx->codec_id =AV_CODEC_ID_HEVC;
 	pCodecCtx->codec_id = fmt->video_codec;
 	pCodecCtx->codec_type = AVMEDIA_TYPE_VIDEO;
-	pCodecCtx->pix_fmt = AV_PIX_FMT_YUV420P;
+	//4:2:2 and 4:4:4 are encoded as they are, libx264 picks the High 4:2:2 / 4:4:4 profile
+	pCodecCtx->pix_fmt = in_fmt;
 	pCodecCtx->width = in_w;  
 	pCodecCtx->height = in_h;
 	pCodecCtx->bit_rate = 400000;  
 	pCodecCtx->gop_size=250;
 
-	pCodecCtx->time_base.num = 1;  
-	pCodecCtx->time_base.den = 25;  
+	pCodecCtx->time_base.num = fps.den;  
+	pCodecCtx->time_base.den = fps.num;  
+	if (in_tc)
+		pCodecCtx->time_base = in_tc->time_base;
+	if (in_y4m && in_y4m->sar.num > 0){
+		pCodecCtx->sample_aspect_ratio = in_y4m->sar;
+		video_st->sample_aspect_ratio = in_y4m->sar;
+	}
 
 	//H264
 	//pCodecCtx->me_range = 16;
@@ -165,6 +354,22 @@ int main(int argc, char* argv[])
 		printf("Can not find encoder! \n");
 		return -1;
 	}
+#if FAST_START
+	//Fast context for the opening segment: same parameters, fast preset
+	AVCodecContext* pFastCtx = avcodec_alloc_context3(NULL);
+	AVDictionary *fast_param = 0;
+	if (!pFastCtx || avcodec_copy_context(pFastCtx, pCodecCtx) < 0){
+		printf("Failed to set up fast-start encoder! \n");
+		return -1;
+	}
+	av_dict_copy(&fast_param, param, 0);
+	av_dict_set(&fast_param, "preset", "veryfast", 0);
+	if (avcodec_open2(pFastCtx, pCodec, &fast_param) < 0){
+		printf("Failed to open fast-start encoder! \n");
+		return -1;
+	}
+	av_dict_free(&fast_param);
+#endif
 	if (avcodec_open2(pCodecCtx, pCodec,&param) < 0){
 		printf("Failed to open encoder! \n");
 		return -1;
@@ -181,22 +386,64 @@ int main(int argc, char* argv[])
 
 	av_new_packet(&pkt,picture_size);
 
-	y_size = pCodecCtx->width * pCodecCtx->height;
+#if FAST_START
+	int fast_frames = FAST_START_SECONDS * fps.num / fps.den;
+	if (in_tc){
+		//the frames shown in the first FAST_START_SECONDS
+		int64_t end = av_rescale(FAST_START_SECONDS, in_tc->time_base.den, in_tc->time_base.num) + in_tc->pts[0];
+		for (fast_frames = 0; timecode_pts(in_tc, fast_frames) < end; fast_frames++)
+			;
+	}
+	if (fast_frames > framenum)
+		fast_frames = framenum;
+	//the main part reads through its own handle, so both can seek freely
+	FILE *fast_in = fopen(in_path, "rb");
+	HeldPackets hold = { NULL, 0, 0, 0 };
+	int fast_ret = 0, main_ret = 0;
+	if (!fast_in){
+		printf("Failed to open input for fast start! \n");
+		return -1;
+	}
+
+#pragma omp parallel sections
+	{
+		#pragma omp section
+		{
+			fast_ret = encode_segment(pFormatCtx, video_st, pFastCtx, fast_in, in_y4m, in_tc, 0, fast_frames, NULL);
+#pragma omp critical(fast_start)
+			{
+				hold.fast_ret = fast_ret;
+				hold.fast_done = 1;
+			}
+		}
+		#pragma omp section
+		main_ret = encode_segment(pFormatCtx, video_st, pCodecCtx, in_file, in_y4m, in_tc, fast_frames, framenum - fast_frames, &hold);
+	}
 
+	//The quality part finished first: append what it held
+	main_ret = release_held(pFormatCtx, &hold, fast_ret < 0 ? fast_ret : main_ret);
+	fclose(fast_in);
+	avcodec_close(pFastCtx);
+	av_free(pFastCtx);
+	if (fast_ret < 0 || main_ret < 0){
+		printf("Fast-start encoding failed\n");
+		return -1;
+	}
+#else
 	for (int i=0; i<framenum; i++){
+		//y4m: every frame starts with a FRAME line, none left means EOF
+		if (in_y4m && y4m_read_frame_header(in_file) < 0)
+			break;
 		//Read raw YUV data
-		if (fread(picture_buf, 1, y_size*3/2, in_file) <= 0){
+		//planes are packed as avpicture_fill() laid them out in picture_buf
+		if (fread(picture_buf, 1, picture_size, in_file) <= 0){
 			printf("Failed to read raw data! \n");
 			return -1;
 		}else if(feof(in_file)){
 			break;
 		}
-		pFrame->data[0] = picture_buf;              // Y
-		pFrame->data[1] = picture_buf+ y_size;      // U 
-		pFrame->data[2] = picture_buf+ y_size*5/4;  // V
-		//PTS
-		//pFrame->pts=i;
-		pFrame->pts=i*(video_st->time_base.den)/((video_st->time_base.num)*25);
+		//PTS, in the codec's time base; packets are rescaled to the stream's below
+		pFrame->pts = in_tc ? timecode_pts(in_tc, i) : i;
 		int got_picture=0;
 		//Encode
 		int ret = avcodec_encode_video2(pCodecCtx, &pkt,pFrame, &got_picture);
@@ -208,6 +455,7 @@ int main(int argc, char* argv[])
 			printf("Succeed to encode frame: %5d\tsize:%5d\n",framecnt,pkt.size);
 			framecnt++;
 			pkt.stream_index = video_st->index;
+			av_packet_rescale_ts(&pkt, pCodecCtx->time_base, video_st->time_base);
 			ret = av_write_frame(pFormatCtx, &pkt);
 			av_free_packet(&pkt);
 		}
@@ -218,6 +466,7 @@ int main(int argc, char* argv[])
 		printf("Flushing encoder failed\n");
 		return -1;
 	}
+#endif
 
 	//Write file trailer
 	av_write_trailer(pFormatCtx);
@@ -232,6 +481,8 @@ int main(int argc, char* argv[])
 	avformat_free_context(pFormatCtx);
 
 	fclose(in_file);
+	if (in_tc)
+		timecode_free(&tc);
 
 	return 0;
 }
@@ -0,0 +1,309 @@
+/**
+ * Black border detection for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after ingest.h
+ * and y4m_reader.h.
+ *
+ * Letterboxed and pillarboxed sources carry black bars the encoder
+ * spends time and bits on; a 2.40:1 film in a 1920x1080 frame is
+ * 1920x800 of picture. Before the encoder is opened, the first
+ * AUTO_CROP_SECONDS of the input are scanned: every luma row is
+ * reduced to its maximum, and every column's maximum is kept in a
+ * row of column maxima on the way, so one pass over the plane gives
+ * both. A row or column is black if no sample in it is above
+ * AUTO_CROP_BLACK. The picture is what is not black in any frame
+ * scanned, so borders have to be stable over the whole scan; frames
+ * that are black all over (fades) do not count.
+ *
+ * The window encoded is the picture rounded out to multiples of 16
+ * into the borders, centred, so the encoder gets whole macroblocks.
+ * Where that does not fit in the frame (no borders on that side, and
+ * a size that is no multiple of 16), the frame is either encoded as it
+ * is, or with AUTO_CROP_PAD padded to a multiple of 16 by repeating
+ * its last column and row. libx264 pads internally and signals the
+ * crop in the stream; padding is for encoders that want mod-16 sizes,
+ * and the padding is part of the decoded picture.
+ *
+ * Cropping and padding happen in the ingest row copy (ingest.h), so
+ * they cost no pass of their own: the rows and columns outside the
+ * window are skipped, the padding is written with the rows.
+ *
+ * The row scan has a C reference; the SSE2 and AVX2 versions give
+ * the same results and are picked from av_get_cpu_flags().
+ */
+
+#ifndef AUTO_CROP_H
+#define AUTO_CROP_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#define crop_seek _fseeki64
+#define crop_tell _ftelli64
+#else
+#define crop_seek fseeko
+#define crop_tell ftello
+#endif
+
+struct CropKernels
+{
+	const char *name;
+	//largest sample of width samples in row, raising colmax to them on the way
+	uint8_t (*scan_row)(const uint8_t *row, uint8_t *colmax, int width);
+};
+
+static uint8_t scan_row_c(const uint8_t *row, uint8_t *colmax, int width)
+{
+	uint8_t top = 0;
+	for (int x = 0; x < width; x++) {
+		if (row[x] > top)
+			top = row[x];
+		if (row[x] > colmax[x])
+			colmax[x] = row[x];
+	}
+	return top;
+}
+
+static const CropKernels crop_kernels_c = { "C", scan_row_c };
+
+#if INGEST_X86
+static inline uint8_t max_epu8_sse2(__m128i v)
+{
+	v = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+	v = _mm_max_epu8(v, _mm_srli_si128(v, 4));
+	v = _mm_max_epu8(v, _mm_srli_si128(v, 2));
+	v = _mm_max_epu8(v, _mm_srli_si128(v, 1));
+	return (uint8_t)_mm_cvtsi128_si32(v);
+}
+
+static uint8_t scan_row_sse2(const uint8_t *row, uint8_t *colmax, int width)
+{
+	__m128i top = _mm_setzero_si128();
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(row + x));
+		__m128i c = _mm_loadu_si128((const __m128i *)(colmax + x));
+		_mm_storeu_si128((__m128i *)(colmax + x), _mm_max_epu8(c, v));
+		top = _mm_max_epu8(top, v);
+	}
+	uint8_t tail = scan_row_c(row + x, colmax + x, width - x);
+	uint8_t body = max_epu8_sse2(top);
+	return body > tail ? body : tail;
+}
+
+static const CropKernels crop_kernels_sse2 = { "SSE2", scan_row_sse2 };
+
+INGEST_TARGET("avx2")
+static uint8_t scan_row_avx2(const uint8_t *row, uint8_t *colmax, int width)
+{
+	__m256i top = _mm256_setzero_si256();
+	int x = 0;
+	for (; x + 32 <= width; x += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(row + x));
+		__m256i c = _mm256_loadu_si256((const __m256i *)(colmax + x));
+		_mm256_storeu_si256((__m256i *)(colmax + x), _mm256_max_epu8(c, v));
+		top = _mm256_max_epu8(top, v);
+	}
+	uint8_t tail = scan_row_c(row + x, colmax + x, width - x);
+	uint8_t body = max_epu8_sse2(_mm_max_epu8(_mm256_castsi256_si128(top), _mm256_extracti128_si256(top, 1)));
+	return body > tail ? body : tail;
+}
+
+static const CropKernels crop_kernels_avx2 = { "AVX2", scan_row_avx2 };
+#endif
+
+//the best kernels for flags from av_get_cpu_flags()
+static const CropKernels *crop_kernels_for(int flags)
+{
+#if INGEST_X86
+	if (flags & AV_CPU_FLAG_AVX2)
+		return &crop_kernels_avx2;
+	if (flags & AV_CPU_FLAG_SSE2)
+		return &crop_kernels_sse2;
+#endif
+	(void)flags;
+	return &crop_kernels_c;
+}
+
+/*
+ * Collects the picture area, the part that is not black, of the luma
+ * planes it is given.
+ */
+class CropDetect
+{
+private:
+	int                  d_width;
+	int                  d_height;
+	int                  d_black;
+	const CropKernels   *d_kernels;
+	std::vector<uint8_t> d_colmax;
+	int                  d_left, d_top, d_right, d_bottom;	// picture so far, right and bottom exclusive
+	int                  d_frames;
+	int                  d_black_frames;
+
+public:
+	//kernels: NULL for the best ones for this CPU
+	CropDetect(int width, int height, int black, const CropKernels *kernels = NULL)
+		: d_width(width), d_height(height), d_black(black),
+		  d_kernels(kernels ? kernels : crop_kernels_for(av_get_cpu_flags())), d_colmax(width),
+		  d_left(width), d_top(height), d_right(0), d_bottom(0), d_frames(0), d_black_frames(0) {}
+
+	const char *name() const { return d_kernels->name; }
+	int frames() const { return d_frames; }
+	int black_frames() const { return d_black_frames; }
+	//false while every frame was black
+	bool found() const { return d_right > d_left; }
+	int left() const { return d_left; }
+	int top() const { return d_top; }
+	int right() const { return d_right; }
+	int bottom() const { return d_bottom; }
+
+	//add the luma plane of one frame, rows stride bytes apart
+	void add(const uint8_t *luma, int stride) {
+		int first = -1, last = -1;
+		memset(&d_colmax[0], 0, d_width);
+		for (int y = 0; y < d_height; y++) {
+			if (d_kernels->scan_row(luma + (size_t)y * stride, &d_colmax[0], d_width) > d_black) {
+				if (first < 0)
+					first = y;
+				last = y;
+			}
+		}
+		d_frames++;
+		if (first < 0) {
+			d_black_frames++;
+			return;
+		}
+		int left = 0, right = d_width;
+		while (d_colmax[left] <= d_black)
+			left++;
+		while (d_colmax[right - 1] <= d_black)
+			right--;
+		d_left = std::min(d_left, left);
+		d_right = std::max(d_right, right);
+		d_top = std::min(d_top, first);
+		d_bottom = std::max(d_bottom, last + 1);
+	}
+};
+
+/*
+ * One axis of the window: the picture [lo, hi) of a frame size long,
+ * rounded out to a multiple of 16 and centred on it. Sets *start,
+ * *length and *padded, the size encoded.
+ */
+static void crop_axis(int lo, int hi, int size, bool pad, int *start, int *length, int *padded)
+{
+	lo &= ~1;	// chroma starts on an even sample
+	int want = (hi - lo + 15) & ~15;
+	if (want <= size) {
+		int s = (lo - (want - (hi - lo)) / 2) & ~1;
+		s = std::max(0, std::min(s, (size - want) & ~1));
+		//an odd size can leave no even start that keeps the last sample
+		if (s + want >= hi) {
+			*start = s;
+			*length = *padded = want;
+			return;
+		}
+	}
+	//no room for a multiple of 16: all of it, padded up or not
+	*start = 0;
+	*length = size;
+	*padded = pad ? (size + 15) & ~15 : size;
+}
+
+//the window to encode of a width x height frame, from what detect saw
+static CropWindow crop_window_for(const CropDetect &detect, int width, int height, bool pad)
+{
+	CropWindow window;
+	if (!detect.found()) {
+		//nothing but black: no picture to crop to
+		crop_axis(0, width, width, pad, &window.x, &window.width, &window.out_width);
+		crop_axis(0, height, height, pad, &window.y, &window.height, &window.out_height);
+		return window;
+	}
+	crop_axis(detect.left(), detect.right(), width, pad, &window.x, &window.width, &window.out_width);
+	crop_axis(detect.top(), detect.bottom(), height, pad, &window.y, &window.height, &window.out_height);
+	return window;
+}
+
+/*
+ * Scan up to frames raw frames of an 8-bit planar format from fp, y4m
+ * if y4m is set, into detect, and seek fp back to where it was.
+ * Returns the frames scanned, -1 if fp cannot be seeked back.
+ */
+static int crop_scan(FILE *fp, bool y4m, AVPixelFormat format, int width, int height, int frames,
+		     CropDetect &detect)
+{
+	long long start = crop_tell(fp);
+	if (start < 0)
+		return -1;
+	std::vector<uint8_t> frame(avpicture_get_size(format, width, height));
+	int scanned = 0;
+	while (scanned < frames && (!y4m || y4m_read_frame_header(fp) == 0) &&
+	       fread(&frame[0], 1, frame.size(), fp) == frame.size()) {
+		//the luma plane comes first, unpadded
+		detect.add(&frame[0], width);
+		scanned++;
+	}
+	clearerr(fp);
+	if (crop_seek(fp, start, SEEK_SET) < 0)
+		return -1;
+	return scanned;
+}
+
+/*
+ * Part of --bench-kernels: scan a 1920x1080 letterboxed frame with
+ * every kernel set the CPU supports, check the picture found against
+ * the C reference and print the throughput.
+ */
+static int run_crop_bench()
+{
+	const int w = 1920, h = 1080;
+	std::vector<const CropKernels *> sets(1, &crop_kernels_c);
+#if INGEST_X86
+	int flags = av_get_cpu_flags();
+	if (flags & AV_CPU_FLAG_SSE2)
+		sets.push_back(&crop_kernels_sse2);
+	if (flags & AV_CPU_FLAG_AVX2)
+		sets.push_back(&crop_kernels_avx2);
+#endif
+	//noise at black level in the bars, picture at 1920x800 with an odd column
+	std::vector<uint8_t> luma((size_t)w * h);
+	unsigned seed = 1;
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			seed = seed * 1103515245 + 12345;
+			bool picture = y >= 140 && y < 940;
+			luma[(size_t)y * w + x] = (uint8_t)(picture ? 16 + (seed >> 16) % 220 : 16 + (seed >> 16) % 4);
+		}
+	}
+	luma[(size_t)500 * w + 1917] = 200;
+	CropDetect ref(w, h, 24, &crop_kernels_c);
+	ref.add(&luma[0], w);
+	int failures = 0;
+	for (size_t s = 0; s < sets.size(); s++) {
+		CropDetect detect(w, h, 24, sets[s]);
+		detect.add(&luma[0], w);
+		bool same = detect.left() == ref.left() && detect.right() == ref.right() &&
+			    detect.top() == ref.top() && detect.bottom() == ref.bottom();
+		int runs = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		double secs = 0;
+		while (secs < 0.25) {
+			detect.add(&luma[0], w);
+			runs++;
+			secs = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - start).count() / 1e6;
+		}
+		printf("Kernel %-7s %-4s: %6.2f GB/s, %7.1f frames/s, %s\n", "crop", sets[s]->name,
+		       luma.size() * (double)runs / secs / 1e9, runs / secs, same ? "matches C" : "DIFFERS FROM C");
+		failures += !same;
+	}
+	return failures ? -1 : 0;
+}
+
+#endif
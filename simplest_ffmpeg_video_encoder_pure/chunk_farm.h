@@ -0,0 +1,657 @@
+/**
+ * Chunk farm for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers. POSIX only.
+ *
+ * The coordinator cuts the raw input into chunks of CHUNK_FRAMES
+ * frames. Every chunk is encoded by a fresh codec context, so it
+ * starts with an IDR and references nothing outside itself; the
+ * bitstreams of consecutive chunks can simply be concatenated.
+ *
+ * Chunks are handed out in one of two ways:
+ *
+ * 	Local workers: CHUNK_WORKERS processes are forked, each
+ * 		connected to the coordinator by a Unix domain socket
+ * 		pair. A job is a ChunkJob header followed by the raw
+ * 		frames, the reply a ChunkResult followed by the bitstream.
+ *
+ * 	File spool: with CHUNK_SPOOL_DIR set, jobs are published as
+ * 		chunk_NNNNNN.job files in a shared directory. Any node can
+ * 		run "<encoder> --spool-worker <dir>", claim a job by
+ * 		renaming it to .claimed, and publish the bitstream as .out
+ * 		(or .failed). Claims older than CHUNK_TIMEOUT seconds are
+ * 		put back. Job files are raw structs, so all nodes must
+ * 		share the same byte order.
+ *
+ * In both cases failed chunks are retried up to CHUNK_RETRIES times,
+ * and results are written in chunk order as soon as they are
+ * contiguous.
+ */
+
+#ifndef CHUNK_FARM_H
+#define CHUNK_FARM_H
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <utime.h>
+#endif
+
+#define CHUNK_JOB_MAGIC     0x4B4E4843	// "CHNK"
+#define CHUNK_RESULT_MAGIC  0x53455243	// "CRES"
+
+/*
+ * Everything a worker needs to encode a chunk, sent ahead of the
+ * raw frames.
+ */
+struct ChunkJob
+{
+	uint32_t magic;
+	int32_t  index;
+	int32_t  first_frame;
+	int32_t  frames;
+	int32_t  codec_id;
+	int32_t  width;
+	int32_t  height;
+	int32_t  bit_rate;
+	int32_t  fps;
+	int32_t  gop_size;
+	int32_t  max_b_frames;
+};
+
+struct ChunkResult
+{
+	uint32_t magic;
+	int32_t  index;
+	int32_t  status;	// 0 on success
+	uint32_t size;		// bitstream bytes that follow
+};
+
+static size_t chunk_frame_size(const ChunkJob &job)
+{
+	return (size_t)job.width * job.height * 3 / 2;
+}
+
+/*
+ * Encode job.frames packed YUV420P frames from raw with a fresh codec
+ * context and append the complete bitstream, flush included, to out.
+ */
+static int encode_chunk(const ChunkJob &job, const uint8_t *raw, std::vector<uint8_t> &out)
+{
+	AVCodec *codec = avcodec_find_encoder((AVCodecID)job.codec_id);
+	if (!codec)
+		return -1;
+	AVCodecContext *ctx = avcodec_alloc_context3(codec);
+	AVFrame *frame = av_frame_alloc();
+	if (!ctx || !frame) {
+		avcodec_free_context(&ctx);
+		av_frame_free(&frame);
+		return -1;
+	}
+	ctx->bit_rate = job.bit_rate;
+	ctx->width = job.width;
+	ctx->height = job.height;
+	ctx->time_base.num = 1;
+	ctx->time_base.den = job.fps;
+	ctx->gop_size = job.gop_size;
+	ctx->max_b_frames = job.max_b_frames;
+	ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+	ctx->thread_count = 1;	// one core per worker, the farm provides the parallelism
+	if (job.codec_id == AV_CODEC_ID_H264)
+		av_opt_set(ctx->priv_data, "preset", "slow", 0);
+	if (avcodec_open2(ctx, codec, NULL) < 0) {
+		avcodec_free_context(&ctx);
+		av_frame_free(&frame);
+		return -1;
+	}
+	frame->format = ctx->pix_fmt;
+	frame->width = ctx->width;
+	frame->height = ctx->height;
+
+	int ret = 0;
+	int got_output;
+	AVPacket pkt;
+	for (int k = 0; ; k++) {
+		AVFrame *in = NULL;
+		if (k < job.frames) {
+			avpicture_fill((AVPicture *)frame, (uint8_t *)raw + k * chunk_frame_size(job),
+				       ctx->pix_fmt, ctx->width, ctx->height);
+			frame->pts = job.first_frame + k;
+			in = frame;
+		}
+		av_init_packet(&pkt);
+		pkt.data = NULL;
+		pkt.size = 0;
+		ret = avcodec_encode_video2(ctx, &pkt, in, &got_output);
+		if (ret < 0)
+			break;
+		if (got_output) {
+			out.insert(out.end(), pkt.data, pkt.data + pkt.size);
+			av_free_packet(&pkt);
+		} else if (!in) {
+			break;	// flushed
+		}
+	}
+
+	avcodec_free_context(&ctx);
+	av_frame_free(&frame);
+	return ret < 0 ? -1 : 0;
+}
+
+#ifndef _WIN32
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0	// SIGPIPE is ignored in run_chunk_farm() instead
+#endif
+
+//a worker that died fails the write with EPIPE instead of killing the sender with SIGPIPE
+static bool write_full(int fd, const void *buf, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)buf;
+	while (len > 0) {
+		ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static bool read_full(int fd, void *buf, size_t len)
+{
+	uint8_t *p = (uint8_t *)buf;
+	while (len > 0) {
+		ssize_t n = read(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+//Read chunk job.index of the input into raw
+static bool read_chunk(FILE *fp_in, const ChunkJob &job, std::vector<uint8_t> &raw)
+{
+	raw.resize(chunk_frame_size(job) * job.frames);
+	if (fseeko(fp_in, (off_t)job.first_frame * chunk_frame_size(job), SEEK_SET) < 0)
+		return false;
+	return fread(raw.data(), 1, raw.size(), fp_in) == raw.size();
+}
+
+/*
+ * Local worker: serve jobs from fd until the coordinator closes it.
+ */
+static void run_socket_worker(int fd)
+{
+	ChunkJob job;
+	std::vector<uint8_t> raw;
+	std::vector<uint8_t> out;
+	while (read_full(fd, &job, sizeof(job)) && job.magic == CHUNK_JOB_MAGIC) {
+		raw.resize(chunk_frame_size(job) * job.frames);
+		if (!read_full(fd, raw.data(), raw.size()))
+			break;
+		out.clear();
+		ChunkResult res;
+		res.magic = CHUNK_RESULT_MAGIC;
+		res.index = job.index;
+		res.status = encode_chunk(job, raw.data(), out);
+		res.size = res.status == 0 ? (uint32_t)out.size() : 0;
+		if (!write_full(fd, &res, sizeof(res)) ||
+		    !write_full(fd, out.data(), res.size))
+			break;
+	}
+	close(fd);
+}
+
+struct FarmWorker
+{
+	pid_t pid;
+	int   fd;
+	int   chunk;	// chunk being encoded, -1 when idle
+};
+
+static bool spawn_worker(FarmWorker &w, std::vector<FarmWorker> &all)
+{
+	int sv[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+		return false;
+	fflush(stdout);	// the child must not inherit unflushed output
+	pid_t pid = fork();
+	if (pid < 0) {
+		close(sv[0]);
+		close(sv[1]);
+		return false;
+	}
+	if (pid == 0) {
+		close(sv[0]);
+		for (size_t k = 0; k < all.size(); k++)
+			if (all[k].fd >= 0)
+				close(all[k].fd);
+		run_socket_worker(sv[1]);
+		_exit(0);
+	}
+	close(sv[1]);
+	w.pid = pid;
+	w.fd = sv[0];
+	w.chunk = -1;
+	return true;
+}
+
+static void retire_worker(FarmWorker &w)
+{
+	if (w.fd >= 0)
+		close(w.fd);
+	if (w.pid > 0) {
+		kill(w.pid, SIGTERM);
+		waitpid(w.pid, NULL, 0);
+	}
+	w.fd = -1;
+	w.pid = -1;
+	w.chunk = -1;
+}
+
+/*
+ * Writes finished chunks in order. Returns the number of chunks
+ * written so far.
+ */
+class ChunkWriter
+{
+private:
+	FILE *d_fp;
+	int   d_next;
+	std::map<int, std::vector<uint8_t> > d_done;
+public:
+	ChunkWriter(FILE *fp): d_fp(fp), d_next(0) {}
+	int add(int index, std::vector<uint8_t> &bits) {
+		d_done[index].swap(bits);
+		while (!d_done.empty() && d_done.begin()->first == d_next) {
+			std::vector<uint8_t> &b = d_done.begin()->second;
+			fwrite(b.data(), 1, b.size(), d_fp);
+			printf("Succeed to encode chunk: %5d\tsize:%8d\n", d_next, (int)b.size());
+			d_done.erase(d_done.begin());
+			d_next++;
+		}
+		return d_next;
+	}
+};
+
+static std::vector<ChunkJob> plan_chunks(FILE *fp_in, const ChunkJob &params, int framenum)
+{
+	std::vector<ChunkJob> jobs;
+	fseeko(fp_in, 0, SEEK_END);
+	off_t available = ftello(fp_in) / (off_t)chunk_frame_size(params);
+	if (framenum > available)
+		framenum = (int)available;
+	for (int first = 0; first < framenum; first += CHUNK_FRAMES) {
+		ChunkJob job = params;
+		job.magic = CHUNK_JOB_MAGIC;
+		job.index = (int)jobs.size();
+		job.first_frame = first;
+		job.frames = framenum - first < CHUNK_FRAMES ? framenum - first : CHUNK_FRAMES;
+		jobs.push_back(job);
+	}
+	return jobs;
+}
+
+/*
+ * Coordinator with CHUNK_WORKERS forked local workers.
+ */
+static int run_local_farm(FILE *fp_in, FILE *fp_out, std::vector<ChunkJob> &jobs)
+{
+	std::vector<FarmWorker> workers(CHUNK_WORKERS);
+	std::vector<int> attempts(jobs.size(), 0);
+	std::deque<int> todo;
+	std::vector<uint8_t> raw;
+	std::vector<uint8_t> bits;
+	ChunkWriter writer(fp_out);
+	int written = 0;
+	int ret = 0;
+
+	for (size_t k = 0; k < workers.size(); k++) {
+		workers[k].pid = -1;
+		workers[k].fd = -1;
+		workers[k].chunk = -1;
+	}
+	for (size_t k = 0; k < workers.size(); k++) {
+		if (!spawn_worker(workers[k], workers)) {
+			printf("Could not start chunk worker %d\n", (int)k);
+			ret = -1;
+		}
+	}
+	for (size_t k = 0; k < jobs.size(); k++)
+		todo.push_back((int)k);
+
+	while (ret == 0 && written < (int)jobs.size()) {
+		//hand out work to idle workers
+		for (size_t k = 0; k < workers.size() && !todo.empty(); k++) {
+			FarmWorker &w = workers[k];
+			if (w.fd < 0 || w.chunk >= 0)
+				continue;
+			ChunkJob &job = jobs[todo.front()];
+			if (!read_chunk(fp_in, job, raw)) {
+				printf("Could not read chunk %d\n", job.index);
+				ret = -1;
+				break;
+			}
+			if (!write_full(w.fd, &job, sizeof(job)) ||
+			    !write_full(w.fd, raw.data(), raw.size())) {
+				printf("Chunk worker %d died, restarting it\n", (int)k);
+				retire_worker(w);
+				if (!spawn_worker(w, workers))
+					printf("Could not restart chunk worker %d\n", (int)k);
+				//the chunk stays first in line
+				if (++attempts[job.index] > CHUNK_RETRIES) {
+					printf("Chunk %d failed %d times, giving up\n", job.index, attempts[job.index]);
+					ret = -1;
+					break;
+				}
+				continue;
+			}
+			w.chunk = todo.front();
+			todo.pop_front();
+		}
+		if (ret < 0)
+			break;
+
+		//wait for results
+		std::vector<struct pollfd> pfds;
+		std::vector<int> owner;
+		int live = 0;
+		for (size_t k = 0; k < workers.size(); k++) {
+			live += workers[k].fd >= 0;
+			if (workers[k].fd >= 0 && workers[k].chunk >= 0) {
+				struct pollfd p;
+				p.fd = workers[k].fd;
+				p.events = POLLIN;
+				p.revents = 0;
+				pfds.push_back(p);
+				owner.push_back((int)k);
+			}
+		}
+		if (pfds.empty() && live > 0 && !todo.empty())
+			continue;	// restarted workers take the work next round
+		if (pfds.empty()) {
+			printf("No chunk workers left\n");
+			ret = -1;
+			break;
+		}
+		if (poll(pfds.data(), pfds.size(), -1) < 0 && errno != EINTR) {
+			ret = -1;
+			break;
+		}
+		for (size_t p = 0; p < pfds.size(); p++) {
+			if (!pfds[p].revents)
+				continue;
+			FarmWorker &w = workers[owner[p]];
+			int chunk = w.chunk;
+			ChunkResult res;
+			bool ok = read_full(w.fd, &res, sizeof(res)) && res.magic == CHUNK_RESULT_MAGIC;
+			if (ok) {
+				bits.resize(res.size);
+				ok = read_full(w.fd, bits.data(), bits.size());
+			}
+			if (!ok) {
+				//the worker is gone, replace it
+				printf("Chunk worker %d died, restarting it\n", owner[p]);
+				retire_worker(w);
+				if (!spawn_worker(w, workers))
+					printf("Could not restart chunk worker %d\n", owner[p]);
+			}
+			w.chunk = -1;
+			if (ok && res.status == 0) {
+				written = writer.add(chunk, bits);
+			} else if (++attempts[chunk] <= CHUNK_RETRIES) {
+				printf("Chunk %d failed, retrying (%d/%d)\n", chunk, attempts[chunk], CHUNK_RETRIES);
+				todo.push_front(chunk);
+			} else {
+				printf("Chunk %d failed %d times, giving up\n", chunk, attempts[chunk]);
+				ret = -1;
+			}
+		}
+	}
+
+	for (size_t k = 0; k < workers.size(); k++)
+		retire_worker(workers[k]);
+	return ret;
+}
+
+static std::string spool_path(const char *dir, int index, const char *ext)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "/chunk_%06d.%s", index, ext);
+	return std::string(dir) + name;
+}
+
+static bool read_file(const std::string &path, std::vector<uint8_t> &data)
+{
+	FILE *fp = fopen(path.c_str(), "rb");
+	if (!fp)
+		return false;
+	fseeko(fp, 0, SEEK_END);
+	data.resize(ftello(fp));
+	fseeko(fp, 0, SEEK_SET);
+	bool ok = fread(data.data(), 1, data.size(), fp) == data.size();
+	fclose(fp);
+	return ok;
+}
+
+//Write to a temporary name first so readers never see partial files
+static bool publish_file(const std::string &path, const void *a, size_t a_len,
+			 const void *b, size_t b_len)
+{
+	std::string tmp = path + ".tmp";
+	FILE *fp = fopen(tmp.c_str(), "wb");
+	if (!fp)
+		return false;
+	bool ok = fwrite(a, 1, a_len, fp) == a_len && fwrite(b, 1, b_len, fp) == b_len;
+	ok = (fclose(fp) == 0) && ok;
+	return ok && rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+/*
+ * Spool worker, run as "<encoder> --spool-worker <dir>" on any node
+ * that sees the shared directory. Exits once the coordinator leaves
+ * a farm.done file.
+ */
+static int run_spool_worker(const char *dir)
+{
+	std::string done = std::string(dir) + "/farm.done";
+	std::vector<uint8_t> data;
+	std::vector<uint8_t> out;
+	printf("Spool worker %d on %s\n", (int)getpid(), dir);
+	while (access(done.c_str(), F_OK) != 0) {
+		bool claimed = false;
+		DIR *d = opendir(dir);
+		if (!d) {
+			printf("Could not open spool %s\n", dir);
+			return -1;
+		}
+		struct dirent *e;
+		while (!claimed && (e = readdir(d)) != NULL) {
+			int index;
+			char ext[8];
+			if (sscanf(e->d_name, "chunk_%d.%7s", &index, ext) != 2 || strcmp(ext, "job"))
+				continue;
+			std::string job_path = spool_path(dir, index, "job");
+			std::string claim_path = spool_path(dir, index, "claimed");
+			//rename is atomic, only one worker wins the claim
+			if (rename(job_path.c_str(), claim_path.c_str()) != 0)
+				continue;
+			claimed = true;
+			utime(claim_path.c_str(), NULL);	// start the claim timeout now
+
+			ChunkJob job;
+			int status = -1;
+			out.clear();
+			if (read_file(claim_path, data) && data.size() >= sizeof(job)) {
+				memcpy(&job, data.data(), sizeof(job));
+				if (job.magic == CHUNK_JOB_MAGIC &&
+				    data.size() == sizeof(job) + chunk_frame_size(job) * job.frames)
+					status = encode_chunk(job, data.data() + sizeof(job), out);
+			}
+			if (status == 0) {
+				publish_file(spool_path(dir, index, "out"), out.data(), out.size(), NULL, 0);
+				printf("Spool worker: chunk %d done\n", index);
+			} else {
+				publish_file(spool_path(dir, index, "failed"), NULL, 0, NULL, 0);
+				printf("Spool worker: chunk %d failed\n", index);
+			}
+			unlink(claim_path.c_str());
+		}
+		closedir(d);
+		if (!claimed)
+			usleep(200000);
+	}
+	return 0;
+}
+
+/*
+ * Coordinator on a file spool. At most 2*CHUNK_WORKERS jobs are
+ * published at a time, which bounds the spool size.
+ */
+static int run_spool_farm(const char *dir, FILE *fp_in, FILE *fp_out, std::vector<ChunkJob> &jobs)
+{
+	std::vector<int> attempts(jobs.size(), 0);
+	std::vector<bool> published(jobs.size(), false);
+	std::vector<uint8_t> raw;
+	std::vector<uint8_t> bits;
+	std::deque<int> todo;
+	ChunkWriter writer(fp_out);
+	int written = 0;
+	int outstanding = 0;
+	int ret = 0;
+
+	mkdir(dir, 0777);
+	unlink((std::string(dir) + "/farm.done").c_str());
+	for (size_t k = 0; k < jobs.size(); k++)
+		todo.push_back((int)k);
+
+	while (ret == 0 && written < (int)jobs.size()) {
+		while (!todo.empty() && outstanding < 2 * CHUNK_WORKERS) {
+			ChunkJob &job = jobs[todo.front()];
+			if (!read_chunk(fp_in, job, raw) ||
+			    !publish_file(spool_path(dir, job.index, "job"), &job, sizeof(job), raw.data(), raw.size())) {
+				printf("Could not publish chunk %d\n", job.index);
+				ret = -1;
+				break;
+			}
+			published[job.index] = true;
+			outstanding++;
+			todo.pop_front();
+		}
+
+		bool progress = false;
+		for (size_t k = 0; ret == 0 && k < jobs.size(); k++) {
+			if (!published[k])
+				continue;
+			int index = (int)k;
+			std::string out_path = spool_path(dir, index, "out");
+			std::string failed_path = spool_path(dir, index, "failed");
+			std::string claim_path = spool_path(dir, index, "claimed");
+			bool failed = false;
+			struct stat st;
+			if (read_file(out_path, bits)) {
+				unlink(out_path.c_str());
+				published[k] = false;
+				outstanding--;
+				written = writer.add(index, bits);
+				progress = true;
+			} else if (access(failed_path.c_str(), F_OK) == 0) {
+				unlink(failed_path.c_str());
+				failed = true;
+			} else if (stat(claim_path.c_str(), &st) == 0 &&
+				   time(NULL) - st.st_mtime > CHUNK_TIMEOUT) {
+				//the node holding the claim is presumed dead
+				unlink(claim_path.c_str());
+				failed = true;
+			}
+			if (failed) {
+				published[k] = false;
+				outstanding--;
+				progress = true;
+				if (++attempts[k] <= CHUNK_RETRIES) {
+					printf("Chunk %d failed, retrying (%d/%d)\n", index, attempts[k], CHUNK_RETRIES);
+					todo.push_front(index);
+				} else {
+					printf("Chunk %d failed %d times, giving up\n", index, attempts[k]);
+					ret = -1;
+				}
+			}
+		}
+		if (!progress)
+			usleep(100000);
+	}
+
+	//tell the workers to leave, and drop anything not picked up
+	publish_file(std::string(dir) + "/farm.done", NULL, 0, NULL, 0);
+	for (size_t k = 0; k < jobs.size(); k++)
+		if (published[k])
+			unlink(spool_path(dir, (int)k, "job").c_str());
+	return ret;
+}
+
+#endif
+
+/*
+ * Encode filename_in to filename_out on the chunk farm. params holds
+ * the codec settings; index, frames and first_frame are filled in
+ * per chunk.
+ */
+static int run_chunk_farm(const char *filename_in, const char *filename_out,
+			  const ChunkJob &params, int framenum)
+{
+#ifdef _WIN32
+	printf("The chunk farm needs a POSIX system\n");
+	return -1;
+#else
+	FILE *fp_in = fopen(filename_in, "rb");
+	if (!fp_in) {
+		printf("Could not open %s\n", filename_in);
+		return -1;
+	}
+	FILE *fp_out = fopen(filename_out, "wb");
+	if (!fp_out) {
+		printf("Could not open %s\n", filename_out);
+		fclose(fp_in);
+		return -1;
+	}
+	//a dead worker is restarted, its socket must not take the coordinator with it
+	signal(SIGPIPE, SIG_IGN);
+	std::vector<ChunkJob> jobs = plan_chunks(fp_in, params, framenum);
+	printf("Chunk farm: %d chunks of up to %d frames\n", (int)jobs.size(), CHUNK_FRAMES);
+
+	int ret;
+	if (CHUNK_SPOOL_DIR[0])
+		ret = run_spool_farm(CHUNK_SPOOL_DIR, fp_in, fp_out, jobs);
+	else
+		ret = run_local_farm(fp_in, fp_out, jobs);
+
+	fclose(fp_in);
+	fclose(fp_out);
+	return ret;
+#endif
+}
+
+#endif
@@ -5,5 +5,5 @@ call "D:\Program Files\Microsoft Visual Studio 10.0\VC\vcvarsall.bat"
 ::lib
 @set LIB=lib;%LIB%
 ::compile and link
-cl simplest_ffmpeg_video_encoder_pure.cpp /link avcodec.lib avutil.lib /OPT:NOREF
+cl simplest_ffmpeg_video_encoder_pure.cpp /link avformat.lib avcodec.lib avutil.lib swscale.lib /OPT:NOREF
 exit
\ No newline at end of file
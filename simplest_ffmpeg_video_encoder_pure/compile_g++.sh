@@ -1,3 +1,3 @@
 #! /bin/sh
-g++ simplest_ffmpeg_video_encoder_pure.cpp -g -fopenmp -o simplest_ffmpeg_video_encoder_pure.out \
--I /usr/local/include -L /usr/local/lib -lavcodec -lavutil
+g++ simplest_ffmpeg_video_encoder_pure.cpp -g -std=c++11 -pthread -o simplest_ffmpeg_video_encoder_pure.out \
+-I /usr/local/include -L /usr/local/lib -lavformat -lavcodec -lavutil -lswscale
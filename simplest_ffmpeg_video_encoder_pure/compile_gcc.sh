@@ -1,3 +1,3 @@
 #! /bin/sh
 gcc simplest_ffmpeg_video_encoder_pure.cpp -g -o simplest_ffmpeg_video_encoder_pure.out \
--I /usr/local/include -L /usr/local/lib -lavcodec -lavutil
+-I /usr/local/include -L /usr/local/lib -lavformat -lavcodec -lavutil -lswscale
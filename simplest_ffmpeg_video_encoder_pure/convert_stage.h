@@ -0,0 +1,231 @@
+/**
+ * Input conversion stage for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers, libswscale's included.
+ *
+ * Capture cards and screen grabbers deliver NV12, YUYV422, UYVY422,
+ * RGB24, BGRA or P010 rather than the planar 4:2:0 the encoders take.
+ * ConvertStage sits between the reader and the encoding stages and
+ * converts every frame with sws_scale(), slice-parallel:
+ *
+ * 	- a frame is cut into horizontal bands of an even number of
+ * 	  rows, and every band is a task of its own on the pool;
+ *
+ * 	- sws_scale() keeps state in its context, so each band has its
+ * 	  own SwsContext, sized for the band. A frame in conversion
+ * 	  holds a whole set of them, and sets are recycled, so there
+ * 	  are never more sets than frames in flight;
+ *
+ * 	- the last band of a frame to finish recycles the source buffer
+ * 	  and hands the converted frame on. Frames finish out of order,
+ * 	  so they are handed on in push order, as the encoders expect.
+ *
+ * Chroma is filtered within a band only, so the rows next to a band
+ * edge see the edge row repeated instead of their neighbour; with
+ * bands of 16 rows and more this is not visible.
+ *
+ * Source buffers come from a FramePool of the input format with rows
+ * unpadded, so one fread() fills a frame.
+ */
+
+#ifndef CONVERT_STAGE_H
+#define CONVERT_STAGE_H
+
+#include <stdio.h>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#define CONVERT_MIN_BAND 16
+
+class ConvertStage
+{
+public:
+	//receives the converted frames (and passed NULLs) in push order
+	typedef std::function<void(AVFrame *frame, int tag)> Deliver;
+
+private:
+	struct Band
+	{
+		int y;
+		int rows;
+	};
+
+	struct Job
+	{
+		AVFrame *frame;
+		int      tag;
+	};
+
+	typedef std::vector<SwsContext *> ContextSet;
+
+	FramePool            d_sources;
+	AVPixelFormat        d_src_fmt;
+	AVPixelFormat        d_dst_fmt;
+	int                  d_width;
+	int                  d_height;
+	int                  d_src_shift[4];	// log2 vertical subsampling per plane
+	int                  d_dst_shift[4];
+	std::vector<Band>    d_bands;
+	Deliver              d_deliver;
+
+	std::mutex           d_mutex;
+	std::vector<ContextSet *> d_free_sets;
+	std::vector<ContextSet *> d_all_sets;
+	std::map<long long, Job> d_done;	// finished, waiting for earlier frames
+	long long            d_next_in;
+	long long            d_next_out;
+
+	static void plane_shifts(AVPixelFormat fmt, int shift[4]) {
+		const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+		for (int p = 0; p < 4; p++)
+			shift[p] = p == 1 || p == 2 ? desc->log2_chroma_h : 0;
+	}
+
+	ContextSet *take_set() {
+		{
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			if (!d_free_sets.empty()) {
+				ContextSet *set = d_free_sets.back();
+				d_free_sets.pop_back();
+				return set;
+			}
+		}
+		ContextSet *set = new ContextSet(d_bands.size(), (SwsContext *)NULL);
+		for (size_t b = 0; b < d_bands.size(); b++) {
+			(*set)[b] = sws_getContext(d_width, d_bands[b].rows, d_src_fmt,
+						   d_width, d_bands[b].rows, d_dst_fmt,
+						   SWS_BILINEAR, NULL, NULL, NULL);
+			if (!(*set)[b]) {
+				free_set(set);
+				return NULL;
+			}
+		}
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		d_all_sets.push_back(set);
+		return set;
+	}
+
+	static void free_set(ContextSet *set) {
+		for (size_t b = 0; b < set->size(); b++)
+			sws_freeContext((*set)[b]);
+		delete set;
+	}
+
+	void convert_band(SwsContext *sws, const Band &band, const AVFrame *src, AVFrame *dst) {
+		const uint8_t *in[4] = { NULL, NULL, NULL, NULL };
+		uint8_t *out[4] = { NULL, NULL, NULL, NULL };
+		for (int p = 0; p < 4; p++) {
+			if (src->data[p])
+				in[p] = src->data[p] + (band.y >> d_src_shift[p]) * src->linesize[p];
+			if (dst->data[p])
+				out[p] = dst->data[p] + (band.y >> d_dst_shift[p]) * dst->linesize[p];
+		}
+		sws_scale(sws, in, src->linesize, 0, band.rows, out, dst->linesize);
+	}
+
+	//frame seq is done, hand on everything that is due
+	void finish(long long seq, AVFrame *frame, int tag) {
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		Job job = { frame, tag };
+		d_done[seq] = job;
+		//deliver under the lock, or two finishers could overtake each other
+		while (!d_done.empty() && d_done.begin()->first == d_next_out) {
+			d_deliver(d_done.begin()->second.frame, d_done.begin()->second.tag);
+			d_done.erase(d_done.begin());
+			d_next_out++;
+		}
+	}
+
+public:
+	/*
+	 * bands: bands per frame, fewer if the frame is too small for
+	 * CONVERT_MIN_BAND rows each
+	 * node: NUMA node of the source buffers, see frame_pool.h
+	 */
+	ConvertStage(AVPixelFormat src_fmt, AVPixelFormat dst_fmt, int width, int height,
+		     int bands, int node, Deliver deliver)
+		: d_sources(width, height, src_fmt, 1, node), d_src_fmt(src_fmt), d_dst_fmt(dst_fmt),
+		  d_width(width), d_height(height), d_deliver(deliver), d_next_in(0), d_next_out(0) {
+		plane_shifts(src_fmt, d_src_shift);
+		plane_shifts(dst_fmt, d_dst_shift);
+		if (bands > height / CONVERT_MIN_BAND)
+			bands = height / CONVERT_MIN_BAND;
+		if (bands < 1)
+			bands = 1;
+		int rows = (height / bands) & ~1;
+		for (int b = 0; b < bands; b++) {
+			Band band = { b * rows, b == bands - 1 ? height - b * rows : rows };
+			d_bands.push_back(band);
+		}
+	}
+
+	~ConvertStage() {
+		for (size_t k = 0; k < d_all_sets.size(); k++)
+			free_set(d_all_sets[k]);
+	}
+
+	//false if libswscale cannot convert between the formats
+	bool init() {
+		ContextSet *set = take_set();
+		if (!set)
+			return false;
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		d_free_sets.push_back(set);
+		return true;
+	}
+
+	int bands() const { return (int)d_bands.size(); }
+
+	//bytes of one packed source frame
+	int source_bytes() const { return avpicture_get_size(d_src_fmt, d_width, d_height); }
+
+	//a source buffer to read a frame into, rows unpadded; NULL when out of memory
+	AVFrame *source() { return d_sources.get(); }
+
+	//give back a source buffer that was not pushed
+	void put_source(AVFrame *src) { d_sources.put(src); }
+
+	/*
+	 * Convert src into dst on pool, then deliver dst with tag; src goes
+	 * back to the source buffers. With src NULL, dst (which may be NULL)
+	 * is delivered unchanged, still behind every frame pushed before.
+	 * Call from one thread only. Returns false, and takes neither
+	 * frame, if no contexts could be allocated.
+	 */
+	bool push(TaskPool &pool, AVFrame *src, AVFrame *dst, int tag) {
+		ContextSet *set = NULL;
+		if (src && !(set = take_set()))
+			return false;
+		long long seq;
+		{
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			seq = d_next_in++;
+		}
+		if (!src) {
+			finish(seq, dst, tag);
+			return true;
+		}
+		std::shared_ptr<std::atomic<int> > left(new std::atomic<int>((int)d_bands.size()));
+		for (size_t b = 0; b < d_bands.size(); b++) {
+			pool.submit([this, set, b, src, dst, tag, seq, left]{
+				this->convert_band((*set)[b], this->d_bands[b], src, dst);
+				if (--*left > 0)
+					return;
+				this->d_sources.put(src);
+				{
+					std::unique_lock<std::mutex> lock(this->d_mutex);
+					this->d_free_sets.push_back(set);
+				}
+				this->finish(seq, dst, tag);
+			});
+		}
+		return true;
+	}
+};
+
+#endif
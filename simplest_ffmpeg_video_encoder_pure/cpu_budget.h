@@ -0,0 +1,180 @@
+/**
+ * CPU budget governor for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers. POSIX only, elsewhere a budget is ignored.
+ *
+ * "--cpu-budget 6.5" caps the encoder at 6.5 cores on average:
+ *
+ * 	- the task pool and libavcodec's own threads are limited to
+ * 	  threads(), the budget rounded up, and
+ *
+ * 	- a governor thread of its own compares, every
+ * 	  CPU_BUDGET_PERIOD_MS, the CPU time of the whole process
+ * 	  (getrusage(), so libavcodec's threads count too) with
+ * 	  budget * wall time. While the process is ahead it holds the
+ * 	  reader, which starves the encoders until the average is back
+ * 	  under the budget; no pool thread sleeps for it, and
+ *
+ * 	- with INTRA_SCALE, the scaler retires an intra context rather
+ * 	  than opening one whenever the reader was held since it last
+ * 	  looked, so a pool that keeps overrunning the budget shrinks.
+ *
+ * Encoding stages add the CPU time of their avcodec_encode_video2()
+ * calls, measured with CLOCK_THREAD_CPUTIME_ID, so the report can
+ * tell the encoder's work from the rest of the pipeline.
+ */
+
+#ifndef CPU_BUDGET_H
+#define CPU_BUDGET_H
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#define CPU_BUDGET_PERIOD_MS 50	// how often the governor looks
+
+class CpuBudget
+{
+private:
+	double d_cores;	// 0 for no budget
+	std::chrono::steady_clock::time_point d_start;
+	double d_cpu_start;
+	double d_slept;
+	std::atomic<long long> d_encode_ns;
+	std::atomic<int> d_holds;
+	std::thread d_governor;
+	std::mutex d_mutex;
+	std::condition_variable d_wake;
+	bool d_stop;
+
+	static double seconds(const std::chrono::steady_clock::duration &d) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1e6;
+	}
+
+	//hold the reader with hold(true) until the process is back within the budget
+	void govern(std::function<void(bool)> hold) {
+		std::unique_lock<std::mutex> lock(d_mutex);
+		bool held = false;
+		while (!d_stop) {
+			double cpu = process_cpu() - d_cpu_start;
+			double wall = seconds(std::chrono::steady_clock::now() - d_start);
+			double ahead = cpu / d_cores - wall;
+			double wait = CPU_BUDGET_PERIOD_MS / 1e3;
+			if (ahead > 0.001) {
+				if (!held) {
+					held = true;
+					d_holds++;
+					hold(true);
+				}
+				//the frames already read keep the encoders going: held until they are paid for
+				wait = std::min(wait, ahead);
+				d_slept += wait;
+			} else if (held) {
+				held = false;
+				hold(false);
+			}
+			d_wake.wait_for(lock, std::chrono::microseconds((long long)(wait * 1e6)));
+		}
+		if (held)
+			hold(false);
+	}
+
+public:
+	CpuBudget(): d_cores(0), d_cpu_start(0), d_slept(0), d_encode_ns(0), d_holds(0), d_stop(false) {}
+	~CpuBudget() { stop(); }
+
+	//false if cores is not a usable budget
+	bool set(double cores) {
+		if (!(cores > 0))
+			return false;
+#ifdef _WIN32
+		printf("CPU budget: not supported on Windows, ignored\n");
+#else
+		d_cores = cores;
+#endif
+		return true;
+	}
+
+	bool enabled() const { return d_cores > 0; }
+	double cores() const { return d_cores; }
+
+	//threads worth running under the budget, fallback without one
+	int threads(int fallback) const {
+		return enabled() ? (int)ceil(d_cores) : fallback;
+	}
+
+	//user + system time of all threads of the process, in seconds
+	static double process_cpu() {
+#ifdef _WIN32
+		return 0;
+#else
+		struct rusage ru;
+		if (getrusage(RUSAGE_SELF, &ru) < 0)
+			return 0;
+		return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+		       (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+#endif
+	}
+
+	//CPU time of the calling thread, in nanoseconds
+	static long long thread_cpu_ns() {
+#if defined(_WIN32) || !defined(CLOCK_THREAD_CPUTIME_ID)
+		return 0;
+#else
+		struct timespec ts;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) < 0)
+			return 0;
+		return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+	}
+
+	//start measuring and, with a budget, the governor; hold pauses and resumes the reader
+	void start(std::function<void(bool)> hold) {
+		d_start = std::chrono::steady_clock::now();
+		d_cpu_start = process_cpu();
+		if (enabled())
+			d_governor = std::thread([=]{ this->govern(hold); });
+	}
+
+	//stop the governor, leaving the reader released
+	void stop() {
+		{
+			std::unique_lock<std::mutex> lock(d_mutex);
+			d_stop = true;
+		}
+		d_wake.notify_all();
+		if (d_governor.joinable())
+			d_governor.join();
+	}
+
+	void add_encode_ns(long long ns) { d_encode_ns += ns; }
+
+	//times the reader was held so far
+	int holds() const { return d_holds; }
+
+	void report(int frames) const {
+		double wall = seconds(std::chrono::steady_clock::now() - d_start);
+		double cpu = process_cpu() - d_cpu_start;
+		if (wall <= 0)
+			return;
+		printf("CPU budget: %.2f cores, used %.2f cores on average, reader held %d times for %.1f s\n",
+		       d_cores, cpu / wall, (int)d_holds, d_slept);
+		printf("CPU budget: encode calls %.2f cores, %d frames at %.2f fps\n",
+		       d_encode_ns / 1e9 / wall, frames, frames / wall);
+	}
+};
+
+#endif
@@ -0,0 +1,170 @@
+/**
+ * Compressed input for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers, libavformat's included.
+ *
+ * With --decode the input is anything libavformat opens, "-" for
+ * stdin: the best video stream is demuxed and decoded, and decoded
+ * frames go to the encoders, so a transcode needs no raw .yuv file
+ * in between:
+ *
+ * 	encoder --decode camera.mp4 out.h264
+ *
+ * The reading stage becomes the decoding stage. The decoder runs with
+ * libavcodec's frame and slice threads, so decoding one frame overlaps
+ * with decoding the next and with the encoders working on the frames
+ * read before.
+ *
+ * Decoded frames are reference counted (refcounted_frames). A frame in
+ * the encoders' format goes to an encoder as it is, without a copy,
+ * and its buffer returns to the decoder's pool when the encoding stage
+ * frees it. READ_AHEAD bounds those frames like pooled ones. A frame in
+ * another format is copied into a source buffer of the conversion
+ * stage, see convert_stage.h.
+ */
+
+#ifndef DECODE_INPUT_H
+#define DECODE_INPUT_H
+
+#include <stdio.h>
+#include <string.h>
+
+class DecodeInput
+{
+private:
+	AVFormatContext *d_format;
+	AVCodecContext  *d_codec;	// the stream's context, opened for decoding
+	int              d_stream;
+	AVPacket         d_packet;	// last packet read
+	AVPacket         d_left;	// the part of it not decoded yet
+	bool             d_draining;	// demuxer done, flushing the decoder
+	bool             d_failed;
+
+public:
+	DecodeInput() : d_format(NULL), d_codec(NULL), d_stream(-1), d_draining(false), d_failed(false) {
+		av_init_packet(&d_packet);
+		d_packet.data = NULL;
+		d_packet.size = 0;
+		d_left = d_packet;
+	}
+
+	~DecodeInput() {
+		av_free_packet(&d_packet);
+		if (d_codec)
+			avcodec_close(d_codec);
+		if (d_format)
+			avformat_close_input(&d_format);
+	}
+
+	//open path and its decoder with threads threads, 0 for one per core; prints why it failed
+	bool open(const char *path, int threads) {
+		if (avformat_open_input(&d_format, strcmp(path, "-") ? path : "pipe:", NULL, NULL) < 0) {
+			printf("Could not open %s\n", path);
+			return false;
+		}
+		if (avformat_find_stream_info(d_format, NULL) < 0) {
+			printf("Could not find the streams of %s\n", path);
+			return false;
+		}
+		AVCodec *decoder = NULL;
+		d_stream = av_find_best_stream(d_format, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+		if (d_stream < 0) {
+			printf("No video stream to decode in %s\n", path);
+			return false;
+		}
+		AVCodecContext *ctx = d_format->streams[d_stream]->codec;
+		ctx->refcounted_frames = 1;
+		ctx->thread_count = threads;
+		ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+		if (avcodec_open2(ctx, decoder, NULL) < 0) {
+			printf("Could not open the %s decoder\n", decoder->name);
+			return false;
+		}
+		d_codec = ctx;
+		return true;
+	}
+
+	int width() const { return d_codec->width; }
+	int height() const { return d_codec->height; }
+	AVPixelFormat pix_fmt() const { return d_codec->pix_fmt; }
+	const char *codec_name() const { return d_codec->codec->name; }
+	int threads() const { return d_codec->thread_count; }
+
+	//frames per second as the container has it, 25 if it does not
+	AVRational frame_rate() const {
+		AVRational rate = av_guess_frame_rate(d_format, d_format->streams[d_stream], NULL);
+		if (rate.num <= 0 || rate.den <= 0) {
+			rate.num = 25;
+			rate.den = 1;
+		}
+		return rate;
+	}
+
+	//0:1 when unknown
+	AVRational sample_aspect_ratio() const {
+		return av_guess_sample_aspect_ratio(d_format, d_format->streams[d_stream], NULL);
+	}
+
+	//true once next() stopped on an error rather than at the end of the input
+	bool failed() const { return d_failed; }
+
+	/*
+	 * The next decoded frame, NULL at the end of the input. The caller
+	 * owns it and frees it with av_frame_free().
+	 */
+	AVFrame *next() {
+		AVFrame *frame = av_frame_alloc();
+		if (!frame) {
+			d_failed = true;
+			return NULL;
+		}
+		while (true) {
+			int got = 0;
+			if (d_left.size <= 0 && !d_draining) {
+				av_free_packet(&d_packet);
+				int ret = av_read_frame(d_format, &d_packet);
+				if (ret == AVERROR_EOF) {
+					d_draining = true;
+				} else if (ret < 0) {
+					//a truncated or corrupt input fails the job, not a shorter encode
+					printf("Error reading the input\n");
+					d_failed = true;
+					break;
+				} else {
+					if (d_packet.stream_index == d_stream)
+						d_left = d_packet;
+					continue;
+				}
+			}
+			if (d_draining) {
+				//an empty packet returns the frames the decoder still holds
+				AVPacket empty;
+				av_init_packet(&empty);
+				empty.data = NULL;
+				empty.size = 0;
+				if (avcodec_decode_video2(d_codec, frame, &got, &empty) < 0 || !got)
+					break;
+			} else {
+				int used = avcodec_decode_video2(d_codec, frame, &got, &d_left);
+				if (used < 0) {
+					printf("Error decoding the input\n");
+					d_failed = true;
+					break;
+				}
+				d_left.data += used;
+				d_left.size -= used;
+				if (!got)
+					continue;
+			}
+			//the input's frame types are no orders for the encoder
+			frame->pict_type = AV_PICTURE_TYPE_NONE;
+			frame->key_frame = 0;
+			return frame;
+		}
+		av_frame_free(&frame);
+		return NULL;
+	}
+};
+
+#endif
@@ -0,0 +1,288 @@
+/**
+ * Recycled raw frames for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers.
+ *
+ * A FramePool hands out frames of one size and format and takes them
+ * back when the encoder is done with them, so a running pipeline does
+ * not allocate at all: the reader never has more than READ_AHEAD
+ * frames in flight, which bounds the pool.
+ *
+ * Buffers are page aligned. Given a NUMA node, a buffer is bound to
+ * that node with mbind() before it is first touched, so the frames
+ * an encoder consumes live next to the CPUs it runs on no matter
+ * which thread filled them. Packets need no such care: libavcodec
+ * allocates them in the encoding thread, and Linux places memory on
+ * the node of the thread that first touches it.
+ *
+ * Optionally (Linux):
+ *
+ * 	hugepages	buffers are rounded up to 2 MB and mapped from
+ * 			explicit hugepages (MAP_HUGETLB, needs pages
+ * 			reserved in vm.nr_hugepages); if none are left,
+ * 			from a 2 MB aligned mapping marked MADV_HUGEPAGE
+ * 			for transparent hugepages; if that fails too,
+ * 			from ordinary pages.
+ *
+ * 	lock		buffers are mlock()ed once touched, so a live job
+ * 			never waits for a page to come back from swap.
+ * 			Fails softly when RLIMIT_MEMLOCK is too small.
+ *
+ * reserve() allocates the frames up front, so all page faults happen
+ * before the first frame instead of mid-stream.
+ */
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <mutex>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define FRAME_POOL_ALIGN 4096
+#define FRAME_POOL_HUGE  (2 << 20)
+
+class FramePool
+{
+public:
+	enum Backing { SMALL_PAGES, TRANSPARENT_HUGEPAGES, EXPLICIT_HUGEPAGES };
+
+private:
+	struct Buffer
+	{
+		AVFrame *frame;
+		void    *mem;
+		size_t   size;
+		Backing  backing;
+		bool     mapped;	// from mmap(), not the heap
+	};
+
+	std::mutex           d_mutex;
+	std::vector<AVFrame*> d_free;
+	std::vector<Buffer>  d_all;
+	int                  d_width;
+	int                  d_height;
+	AVPixelFormat        d_format;
+	int                  d_align;
+	int                  d_node;
+	bool                 d_bound;
+	bool                 d_hugepages;
+	bool                 d_lock;
+	bool                 d_locked;
+
+	void *alloc_buffer(Buffer &buf) {
+		buf.backing = SMALL_PAGES;
+		buf.mapped = false;
+#if defined(__linux__) && defined(MAP_HUGETLB)
+		if (d_hugepages) {
+			size_t huge = (buf.size + FRAME_POOL_HUGE - 1) / FRAME_POOL_HUGE * FRAME_POOL_HUGE;
+			void *mem = mmap(NULL, huge, PROT_READ | PROT_WRITE,
+					 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (mem != MAP_FAILED) {
+				buf.size = huge;
+				buf.backing = EXPLICIT_HUGEPAGES;
+				buf.mapped = true;
+				return mem;
+			}
+			//over-map by a hugepage to cut a 2 MB aligned range out of it
+			char *raw = (char *)mmap(NULL, huge + FRAME_POOL_HUGE, PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (raw != MAP_FAILED) {
+				char *aligned = (char *)(((uintptr_t)raw + FRAME_POOL_HUGE - 1) & ~(uintptr_t)(FRAME_POOL_HUGE - 1));
+				if (aligned > raw)
+					munmap(raw, aligned - raw);
+				munmap(aligned + huge, raw + FRAME_POOL_HUGE - aligned);
+				buf.size = huge;
+				buf.mapped = true;
+				if (madvise(aligned, huge, MADV_HUGEPAGE) == 0)
+					buf.backing = TRANSPARENT_HUGEPAGES;
+				return aligned;
+			}
+		}
+#endif
+#ifdef _WIN32
+		return _aligned_malloc(buf.size, FRAME_POOL_ALIGN);
+#else
+		void *mem = NULL;
+		if (posix_memalign(&mem, FRAME_POOL_ALIGN, buf.size))
+			return NULL;
+		return mem;
+#endif
+	}
+
+	static void free_buffer(const Buffer &buf) {
+#ifdef __linux__
+		if (buf.mapped) {
+			munmap(buf.mem, buf.size);
+			return;
+		}
+#endif
+#ifdef _WIN32
+		_aligned_free(buf.mem);
+#else
+		free(buf.mem);
+#endif
+	}
+
+	//prefer node for the pages of buf, false if the kernel refuses
+	static bool bind_buffer(void *buf, size_t size, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+		const int mpol_preferred = 1;	// MPOL_PREFERRED, linux/mempolicy.h
+		unsigned long mask[16] = { 0 };
+		if (node < 0 || node >= (int)(sizeof(mask) * 8))
+			return false;
+		mask[node / (sizeof(long) * 8)] = 1UL << (node % (sizeof(long) * 8));
+		return syscall(SYS_mbind, buf, size, mpol_preferred, mask, sizeof(mask) * 8, 0) == 0;
+#else
+		return false;
+#endif
+	}
+
+	//allocate, bind, touch and lock a new buffer and its frame
+	bool alloc_frame(Buffer &buf, bool &bound, bool &locked) {
+		AVFrame *frame = av_frame_alloc();
+		if (!frame)
+			return false;
+		//rows padded to the alignment, every row starts aligned
+		int linesize[4];
+		uint8_t *data[4];
+		if (av_image_fill_linesizes(linesize, d_format, d_width) < 0) {
+			av_frame_free(&frame);
+			return false;
+		}
+		for (int p = 0; p < 4; p++)
+			linesize[p] = FFALIGN(linesize[p], d_align);
+		int size = av_image_fill_pointers(data, d_format, d_height, NULL, linesize);
+		buf.size = size > 0 ? size : 0;
+		uint8_t *mem = size > 0 ? (uint8_t *)alloc_buffer(buf) : NULL;
+		if (!mem) {
+			av_frame_free(&frame);
+			return false;
+		}
+		bound = d_node < 0 || bind_buffer(mem, buf.size, d_node);
+		memset(mem, 0, buf.size);	// first touch, after the binding
+#ifdef __linux__
+		locked = !d_lock || mlock(mem, buf.size) == 0;
+#else
+		locked = !d_lock;
+#endif
+		av_image_fill_pointers(frame->data, d_format, d_height, mem, linesize);
+		for (int p = 0; p < 4; p++)
+			frame->linesize[p] = linesize[p];
+		frame->format = d_format;
+		frame->width = d_width;
+		frame->height = d_height;
+		buf.frame = frame;
+		buf.mem = mem;
+		return true;
+	}
+
+public:
+	/*
+	 * align: row alignment in bytes, at most FRAME_POOL_ALIGN
+	 * node: NUMA node for the buffers, -1 for wherever they are first touched
+	 * hugepages, lock: see above
+	 */
+	FramePool(int width, int height, AVPixelFormat format, int align = 32, int node = -1,
+		  bool hugepages = false, bool lock = false)
+		: d_width(width), d_height(height), d_format(format), d_align(align), d_node(node), d_bound(true),
+		  d_hugepages(hugepages), d_lock(lock), d_locked(true) {}
+
+	~FramePool() {
+		for (size_t k = 0; k < d_all.size(); k++) {
+#ifdef __linux__
+			if (d_lock)
+				munlock(d_all[k].mem, d_all[k].size);
+#endif
+			free_buffer(d_all[k]);
+			av_frame_free(&d_all[k].frame);
+		}
+	}
+
+	//a frame ready to be filled, NULL when out of memory
+	AVFrame *get() {
+		{
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			if (!d_free.empty()) {
+				AVFrame *frame = d_free.back();
+				d_free.pop_back();
+				return frame;
+			}
+		}
+		Buffer buf;
+		bool bound, locked;
+		if (!alloc_frame(buf, bound, locked))
+			return NULL;
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		d_all.push_back(buf);
+		d_bound = d_bound && bound;
+		d_locked = d_locked && locked;
+		return buf.frame;
+	}
+
+	//give back a frame from get(), the per-frame settings are reset
+	void put(AVFrame *frame) {
+		frame->pts = AV_NOPTS_VALUE;
+		frame->pict_type = AV_PICTURE_TYPE_NONE;
+		frame->key_frame = 0;
+		frame->quality = 0;
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		d_free.push_back(frame);
+	}
+
+	//allocate frames up front until count exist, false when out of memory
+	bool reserve(int count) {
+		std::vector<AVFrame*> taken;
+		bool ok = true;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(this->d_mutex);
+				if ((int)d_all.size() >= count)
+					break;
+			}
+			AVFrame *frame = get();
+			if (!frame) {
+				ok = false;
+				break;
+			}
+			taken.push_back(frame);
+		}
+		for (size_t k = 0; k < taken.size(); k++)
+			put(taken[k]);
+		return ok;
+	}
+
+	//false if a NUMA binding was requested and refused
+	bool bound() {
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		return d_bound;
+	}
+
+	//false if locking was requested and refused
+	bool locked() {
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		return d_locked;
+	}
+
+	//one line on how the frames are backed, for the startup report
+	void describe(char *buf, int size) {
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		int pages[3] = { 0, 0, 0 };
+		for (size_t k = 0; k < d_all.size(); k++)
+			pages[d_all[k].backing]++;
+		snprintf(buf, size, "%d frames of %d bytes: %d on hugetlb pages, %d marked for transparent hugepages, %d on 4K pages%s",
+			 (int)d_all.size(), d_all.empty() ? 0 : (int)d_all[0].size,
+			 pages[EXPLICIT_HUGEPAGES], pages[TRANSPARENT_HUGEPAGES], pages[SMALL_PAGES],
+			 d_lock ? (d_locked ? ", locked" : ", NOT locked (RLIMIT_MEMLOCK?)") : "");
+	}
+};
+
+#endif
@@ -0,0 +1,339 @@
+/**
+ * idr_pic_id rewriting for the intra-only H.264 pool
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers.
+ *
+ * Every frame of the intra-only mode is an IDR, and each context of
+ * the pool numbers its IDRs on its own (libx264 toggles idr_pic_id
+ * between 0 and 1). Put back into pts order, two neighbouring IDRs
+ * can then carry the same idr_pic_id, which H.264 7.4.3 forbids, and
+ * a decoder may take them for slices of one picture.
+ *
+ * The writing stage passes each picture through idr_rewrite_packet()
+ * in output order. When its idr_pic_id equals the previous picture's,
+ * the slice headers get another one. The new value's ue(v) code is
+ * a multiple of 8 bits longer or shorter than the old one, so
+ * everything behind it keeps its bit position within the byte: the
+ * cabac_alignment_one_bits, the slice data and any pcm alignment stay
+ * valid, and the rest of the slice header needs no parsing. Only
+ * the SPS and PPS fields up to idr_pic_id are read. They come in-band
+ * with every IDR, CODEC_FLAG_GLOBAL_HEADER is not set.
+ */
+
+#ifndef IDR_REWRITE_H
+#define IDR_REWRITE_H
+
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+
+typedef struct IdrSps {
+	int valid;
+	int separate_colour_plane;
+	int log2_max_frame_num;
+	int frame_mbs_only;
+} IdrSps;
+
+typedef struct IdrRewriter {
+	IdrSps sps[32];
+	int pps_sps[256];	// sps id of each pps, -1 if not seen
+	int prev_id;		// idr_pic_id of the last picture, -1 if it was no IDR
+} IdrRewriter;
+
+static void idr_rewriter_init(IdrRewriter *w)
+{
+	memset(w->sps, 0, sizeof(w->sps));
+	for (int i = 0; i < 256; i++)
+		w->pps_sps[i] = -1;
+	w->prev_id = -1;
+}
+
+/*
+ * Bit reader over an RBSP, reading past the end sets overrun
+ */
+typedef struct IdrBits {
+	const uint8_t *data;
+	size_t bits;
+	size_t pos;
+	int overrun;
+} IdrBits;
+
+static unsigned idr_read_bits(IdrBits *b, int n)
+{
+	unsigned v = 0;
+	while (n-- > 0) {
+		if (b->pos >= b->bits) {
+			b->overrun = 1;
+			return 0;
+		}
+		v = v << 1 | ((b->data[b->pos >> 3] >> (7 - (b->pos & 7))) & 1);
+		b->pos++;
+	}
+	return v;
+}
+
+static unsigned idr_read_ue(IdrBits *b)
+{
+	int zeros = 0;
+	while (!idr_read_bits(b, 1)) {
+		if (b->overrun || ++zeros > 31) {
+			b->overrun = 1;
+			return 0;
+		}
+	}
+	return (1u << zeros) - 1 + idr_read_bits(b, zeros);
+}
+
+static void idr_skip_se(IdrBits *b)
+{
+	idr_read_ue(b);
+}
+
+//bits of the ue(v) code of v
+static int idr_ue_size(unsigned v)
+{
+	int k = 0;
+	while ((v + 1) >> (k + 1))
+		k++;
+	return 2 * k + 1;
+}
+
+static void idr_put_bits(std::vector<uint8_t> &out, size_t *pos, unsigned v, int n)
+{
+	while (n-- > 0) {
+		if ((*pos & 7) == 0)
+			out.push_back(0);
+		out.back() |= ((v >> n) & 1) << (7 - (*pos & 7));
+		(*pos)++;
+	}
+}
+
+static void idr_put_ue(std::vector<uint8_t> &out, size_t *pos, unsigned v)
+{
+	int size = idr_ue_size(v);
+	idr_put_bits(out, pos, 0, size / 2);
+	idr_put_bits(out, pos, v + 1, size / 2 + 1);
+}
+
+//drop the emulation prevention bytes of a NAL unit's payload
+static void idr_unescape(const uint8_t *src, int size, std::vector<uint8_t> &rbsp)
+{
+	int zeros = 0;
+	rbsp.clear();
+	for (int i = 0; i < size; i++) {
+		if (zeros >= 2 && src[i] == 3) {
+			zeros = 0;
+			continue;
+		}
+		zeros = src[i] ? 0 : zeros + 1;
+		rbsp.push_back(src[i]);
+	}
+}
+
+static void idr_escape(const std::vector<uint8_t> &rbsp, std::vector<uint8_t> &out)
+{
+	int zeros = 0;
+	for (size_t i = 0; i < rbsp.size(); i++) {
+		if (zeros >= 2 && rbsp[i] <= 3) {
+			out.push_back(3);
+			zeros = 0;
+		}
+		zeros = rbsp[i] ? 0 : zeros + 1;
+		out.push_back(rbsp[i]);
+	}
+	//cabac_zero_words: a NAL unit must not end in 0x00
+	if (zeros)
+		out.push_back(3);
+}
+
+static int idr_parse_sps(IdrRewriter *w, const std::vector<uint8_t> &rbsp)
+{
+	IdrBits b = { rbsp.data(), rbsp.size() * 8, 0, 0 };
+	IdrSps sps = { 1, 0, 0, 0 };
+	int profile_idc = idr_read_bits(&b, 8);
+	idr_read_bits(&b, 16);	// constraint flags, level_idc
+	unsigned id = idr_read_ue(&b);
+	if (id >= 32)
+		return -1;
+	if (profile_idc == 100 || profile_idc == 110 || profile_idc == 122 || profile_idc == 244 ||
+	    profile_idc == 44 || profile_idc == 83 || profile_idc == 86 || profile_idc == 118 ||
+	    profile_idc == 128 || profile_idc == 138 || profile_idc == 139 || profile_idc == 134 ||
+	    profile_idc == 135) {
+		unsigned chroma_format_idc = idr_read_ue(&b);
+		if (chroma_format_idc == 3)
+			sps.separate_colour_plane = idr_read_bits(&b, 1);
+		idr_read_ue(&b);	// bit_depth_luma_minus8
+		idr_read_ue(&b);	// bit_depth_chroma_minus8
+		idr_read_bits(&b, 1);	// qpprime_y_zero_transform_bypass_flag
+		if (idr_read_bits(&b, 1)) {
+			for (int i = 0; i < (chroma_format_idc != 3 ? 8 : 12) && !b.overrun; i++) {
+				if (!idr_read_bits(&b, 1))
+					continue;
+				int last = 8, next = 8;
+				for (int j = 0; j < (i < 6 ? 16 : 64) && !b.overrun; j++) {
+					if (next) {
+						unsigned code = idr_read_ue(&b);
+						int delta = code & 1 ? (int)(code + 1) / 2 : -(int)(code / 2);
+						next = (last + delta + 256) % 256;
+					}
+					last = next ? next : last;
+				}
+			}
+		}
+	}
+	sps.log2_max_frame_num = idr_read_ue(&b) + 4;
+	unsigned poc_type = idr_read_ue(&b);
+	if (poc_type == 0) {
+		idr_read_ue(&b);	// log2_max_pic_order_cnt_lsb_minus4
+	} else if (poc_type == 1) {
+		idr_read_bits(&b, 1);	// delta_pic_order_always_zero_flag
+		idr_skip_se(&b);	// offset_for_non_ref_pic
+		idr_skip_se(&b);	// offset_for_top_to_bottom_field
+		unsigned cycle = idr_read_ue(&b);
+		if (cycle > 255)
+			return -1;
+		for (unsigned i = 0; i < cycle; i++)
+			idr_skip_se(&b);
+	}
+	idr_read_ue(&b);	// max_num_ref_frames
+	idr_read_bits(&b, 1);	// gaps_in_frame_num_value_allowed_flag
+	idr_read_ue(&b);	// pic_width_in_mbs_minus1
+	idr_read_ue(&b);	// pic_height_in_map_units_minus1
+	sps.frame_mbs_only = idr_read_bits(&b, 1);
+	if (b.overrun || sps.log2_max_frame_num > 16)
+		return -1;
+	w->sps[id] = sps;
+	return 0;
+}
+
+static int idr_parse_pps(IdrRewriter *w, const std::vector<uint8_t> &rbsp)
+{
+	IdrBits b = { rbsp.data(), rbsp.size() * 8, 0, 0 };
+	unsigned id = idr_read_ue(&b);
+	unsigned sps_id = idr_read_ue(&b);
+	if (b.overrun || id >= 256 || sps_id >= 32)
+		return -1;
+	w->pps_sps[id] = sps_id;
+	return 0;
+}
+
+/*
+ * Find idr_pic_id in an IDR slice: it starts at bit *id_pos of the
+ * RBSP, which is past the NAL header byte. Returns its value, -1 on error.
+ */
+static int idr_find_pic_id(const IdrRewriter *w, const std::vector<uint8_t> &rbsp, size_t *id_pos)
+{
+	IdrBits b = { rbsp.data(), rbsp.size() * 8, 0, 0 };
+	idr_read_ue(&b);	// first_mb_in_slice
+	idr_read_ue(&b);	// slice_type
+	unsigned pps_id = idr_read_ue(&b);
+	if (b.overrun || pps_id >= 256 || w->pps_sps[pps_id] < 0 || !w->sps[w->pps_sps[pps_id]].valid)
+		return -1;
+	const IdrSps *sps = &w->sps[w->pps_sps[pps_id]];
+	if (sps->separate_colour_plane)
+		idr_read_bits(&b, 2);	// colour_plane_id
+	idr_read_bits(&b, sps->log2_max_frame_num);	// frame_num
+	if (!sps->frame_mbs_only && idr_read_bits(&b, 1))
+		idr_read_bits(&b, 1);	// bottom_field_flag
+	*id_pos = b.pos;
+	unsigned id = idr_read_ue(&b);
+	return b.overrun || id > 65535 ? -1 : (int)id;
+}
+
+//a value other than avoid whose ue(v) code is a multiple of 8 bits longer than one of size bits
+static unsigned idr_pick_id(int size, int avoid)
+{
+	for (;; size += 8) {
+		unsigned first = (1u << (size / 2)) - 1, last = (1u << (size / 2 + 1)) - 2;
+		for (unsigned v = first; v <= last; v++)
+			if ((int)v != avoid)
+				return v;
+	}
+}
+
+/*
+ * Give pkt, one H.264 picture in Annex B, an idr_pic_id other than
+ * the previous picture's. Returns 0, or -1 if pkt could not be parsed.
+ */
+static int idr_rewrite_packet(IdrRewriter *w, AVPacket *pkt)
+{
+	struct Nal { int start, end; size_t id_pos; };
+	std::vector<Nal> slices;
+	std::vector<uint8_t> rbsp;
+	int pic_id = -1;
+
+	for (int i = 0; i + 3 <= pkt->size; ) {
+		if (pkt->data[i] || pkt->data[i + 1] || pkt->data[i + 2] != 1) {
+			i++;
+			continue;
+		}
+		Nal nal = { i + 3, pkt->size, 0 };
+		for (i = nal.start; i + 3 <= pkt->size; i++)
+			if (!pkt->data[i] && !pkt->data[i + 1] && pkt->data[i + 2] == 1) {
+				nal.end = i;
+				break;
+			}
+		//zero bytes before a start code belong to it
+		while (nal.end > nal.start && !pkt->data[nal.end - 1])
+			nal.end--;
+		if (nal.end <= nal.start)
+			continue;
+		int type = pkt->data[nal.start] & 0x1f;
+		if (type != 5 && type != 7 && type != 8)
+			continue;
+		idr_unescape(pkt->data + nal.start + 1, nal.end - nal.start - 1, rbsp);
+		if (type == 7 && idr_parse_sps(w, rbsp) < 0)
+			return -1;
+		if (type == 8 && idr_parse_pps(w, rbsp) < 0)
+			return -1;
+		if (type == 5) {
+			//all slices of a picture carry the same idr_pic_id
+			int id = idr_find_pic_id(w, rbsp, &nal.id_pos);
+			if (id < 0 || (pic_id >= 0 && id != pic_id))
+				return -1;
+			pic_id = id;
+			slices.push_back(nal);
+		}
+	}
+
+	int prev_id = w->prev_id;
+	w->prev_id = pic_id;
+	if (pic_id < 0 || pic_id != prev_id)
+		return 0;
+
+	unsigned new_id = idr_pick_id(idr_ue_size(pic_id), pic_id);
+	std::vector<uint8_t> out, spliced;
+	int copied = 0;
+	for (size_t s = 0; s < slices.size(); s++) {
+		const Nal &nal = slices[s];
+		out.insert(out.end(), pkt->data + copied, pkt->data + nal.start + 1);
+		idr_unescape(pkt->data + nal.start + 1, nal.end - nal.start - 1, rbsp);
+		IdrBits b = { rbsp.data(), rbsp.size() * 8, 0, 0 };
+		size_t pos = 0;
+		spliced.clear();
+		while (b.pos < nal.id_pos)
+			idr_put_bits(spliced, &pos, idr_read_bits(&b, 1), 1);
+		idr_read_ue(&b);
+		idr_put_ue(spliced, &pos, new_id);
+		//same bit phase as the old code, so the rest is a byte copy once aligned
+		while (b.pos & 7)
+			idr_put_bits(spliced, &pos, idr_read_bits(&b, 1), 1);
+		spliced.insert(spliced.end(), rbsp.begin() + b.pos / 8, rbsp.end());
+		idr_escape(spliced, out);
+		copied = nal.end;
+	}
+	out.insert(out.end(), pkt->data + copied, pkt->data + pkt->size);
+
+	AVPacket rewritten;
+	if (av_new_packet(&rewritten, (int)out.size()) < 0)
+		return -1;
+	memcpy(rewritten.data, out.data(), out.size());
+	av_packet_copy_props(&rewritten, pkt);
+	av_free_packet(pkt);
+	*pkt = rewritten;
+	w->prev_id = new_id;
+	return 0;
+}
+
+#endif
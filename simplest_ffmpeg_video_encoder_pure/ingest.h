@@ -0,0 +1,369 @@
+/**
+ * Raw frame ingest for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers.
+ *
+ * Raw files store every plane packed, row after row with no padding.
+ * Frames from the frame pool have their rows padded to the ingest
+ * alignment, so a plane cannot be read in one piece. Ingest reads a
+ * whole raw frame with one fread() into a staging buffer and copies
+ * it into the frame row by row, honouring linesize.
+ *
+ * The layout is a compile-time parameter: PlaneLayout describes the
+ * planes of a pixel format (chroma subsampling, bit depth) with
+ * constexpr functions, so the row sizes of all planes are computed
+ * once per frame size and the copy loop has nothing left to decide.
+ *
+ * The row copy is picked at runtime from av_get_cpu_flags(): AVX2 or
+ * SSE2 with non-temporal stores, which write the frame without
+ * pulling it into the cache (the encoder reads it much later, from
+ * another core), or memcpy() elsewhere.
+ *
+ * Ingest can also keep only a window of the frame and pad it out to a
+ * larger size by repeating its last column and row, see auto_crop.h:
+ * the copy skips what is outside the window and writes the padding
+ * with the rows.
+ *
+ * High bit depth samples are 16-bit little-endian words. Their row
+ * copy also validates them: a sample above the layout's depth (e.g.
+ * P010 or 16-bit data fed in as yuv420p10le) would make the encoder
+ * wrap it around, so it is clipped to the maximum, and the frame is
+ * counted in clipped().
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define INGEST_X86 1
+#include <immintrin.h>
+#else
+#define INGEST_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define INGEST_TARGET(isa) __attribute__((target(isa)))
+#else
+#define INGEST_TARGET(isa)
+#endif
+
+/*
+ * Plane layout of a planar YUV format.
+ *
+ * 	ShiftW, ShiftH: chroma subsampling as log2, 1/1 for 4:2:0
+ * 	Depth: bits per sample, more than 8 takes two bytes
+ */
+template <AVPixelFormat Format, int ShiftW, int ShiftH, int Depth>
+struct PlaneLayout
+{
+	static const AVPixelFormat format = Format;
+	static const int planes = 3;
+	static const int depth = Depth;
+	static const int sample_bytes = Depth > 8 ? 2 : 1;
+
+	static constexpr int width(int plane, int w) {
+		return plane ? (w + (1 << ShiftW) - 1) >> ShiftW : w;
+	}
+	static constexpr int height(int plane, int h) {
+		return plane ? (h + (1 << ShiftH) - 1) >> ShiftH : h;
+	}
+	static constexpr int row_bytes(int plane, int w) {
+		return width(plane, w) * sample_bytes;
+	}
+	//size of one packed raw frame
+	static constexpr size_t frame_bytes(int w, int h) {
+		return (size_t)row_bytes(0, w) * height(0, h) +
+		       (size_t)row_bytes(1, w) * height(1, h) * 2;
+	}
+};
+
+typedef PlaneLayout<AV_PIX_FMT_YUV420P, 1, 1, 8>      LayoutYUV420P;
+typedef PlaneLayout<AV_PIX_FMT_YUV422P, 1, 0, 8>      LayoutYUV422P;
+typedef PlaneLayout<AV_PIX_FMT_YUV444P, 0, 0, 8>      LayoutYUV444P;
+typedef PlaneLayout<AV_PIX_FMT_YUV420P10LE, 1, 1, 10> LayoutYUV420P10;
+typedef PlaneLayout<AV_PIX_FMT_YUV422P10LE, 1, 0, 10> LayoutYUV422P10;
+typedef PlaneLayout<AV_PIX_FMT_YUV444P10LE, 0, 0, 10> LayoutYUV444P10;
+
+/*
+ * Part of the frame to keep, in luma samples: x, y, width and height
+ * of the window, even for the chroma planes, and the size it is padded
+ * out to.
+ */
+struct CropWindow
+{
+	int x, y, width, height;
+	int out_width, out_height;
+};
+
+typedef void (*RowCopy)(uint8_t *dst, const uint8_t *src, int bytes);
+//copies 16-bit samples clipped to max, returns nonzero if any was above
+typedef unsigned (*RowCopy16)(uint8_t *dst, const uint8_t *src, int bytes, uint16_t max);
+
+/*
+ * Reads one raw frame per call into a pooled frame, whatever the
+ * input format; see Ingest below and ingest_kernels.h.
+ */
+class FrameReader
+{
+public:
+	virtual ~FrameReader() {}
+	virtual const char *name() const = 0;
+	//read the next raw frame into frame, false on a short read
+	virtual bool read(FILE *fp, AVFrame *frame) = 0;
+	//frames with samples out of range
+	virtual int clipped() const { return 0; }
+	//keep only window of every frame, false if this reader cannot
+	virtual bool crop(const CropWindow &window) { (void)window; return false; }
+};
+
+static void copy_row_c(uint8_t *dst, const uint8_t *src, int bytes)
+{
+	memcpy(dst, src, bytes);
+}
+
+//max is 2^depth - 1, so a sample is out of range if it has bits outside max
+static unsigned copy_row16_c(uint8_t *dst, const uint8_t *src, int bytes, uint16_t max)
+{
+	unsigned over = 0;
+	for (int x = 0; x + 1 < bytes; x += 2) {
+		uint16_t v = (uint16_t)(src[x] | src[x + 1] << 8);
+		over |= v & ~max;
+		if (v & ~max)
+			v = max;
+		dst[x] = (uint8_t)v;
+		dst[x + 1] = (uint8_t)(v >> 8);
+	}
+	return over;
+}
+
+#if INGEST_X86
+//dst must be 16 byte aligned
+static void copy_row_sse2(uint8_t *dst, const uint8_t *src, int bytes)
+{
+	int x = 0;
+	for (; x + 64 <= bytes; x += 64) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(src + x));
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + x + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *)(src + x + 32));
+		__m128i d = _mm_loadu_si128((const __m128i *)(src + x + 48));
+		_mm_stream_si128((__m128i *)(dst + x), a);
+		_mm_stream_si128((__m128i *)(dst + x + 16), b);
+		_mm_stream_si128((__m128i *)(dst + x + 32), c);
+		_mm_stream_si128((__m128i *)(dst + x + 48), d);
+	}
+	for (; x + 16 <= bytes; x += 16)
+		_mm_stream_si128((__m128i *)(dst + x), _mm_loadu_si128((const __m128i *)(src + x)));
+	memcpy(dst + x, src + x, bytes - x);
+}
+
+//dst must be 16 byte aligned
+static unsigned copy_row16_sse2(uint8_t *dst, const uint8_t *src, int bytes, uint16_t max)
+{
+	const __m128i vmax = _mm_set1_epi16((short)max);
+	const __m128i high = _mm_set1_epi16((short)(uint16_t)~max);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i over = zero;
+	int x = 0;
+	for (; x + 16 <= bytes; x += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + x));
+		__m128i h = _mm_and_si128(v, high);
+		over = _mm_or_si128(over, h);
+		//in range: keep v, else max
+		__m128i ok = _mm_cmpeq_epi16(h, zero);
+		_mm_stream_si128((__m128i *)(dst + x), _mm_or_si128(_mm_and_si128(ok, v), _mm_andnot_si128(ok, vmax)));
+	}
+	unsigned tail = copy_row16_c(dst + x, src + x, bytes - x, max);
+	return tail | (_mm_movemask_epi8(_mm_cmpeq_epi16(over, zero)) != 0xffff);
+}
+
+//dst must be 32 byte aligned
+INGEST_TARGET("avx2")
+static void copy_row_avx2(uint8_t *dst, const uint8_t *src, int bytes)
+{
+	int x = 0;
+	for (; x + 128 <= bytes; x += 128) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(src + x));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(src + x + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i *)(src + x + 64));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(src + x + 96));
+		_mm256_stream_si256((__m256i *)(dst + x), a);
+		_mm256_stream_si256((__m256i *)(dst + x + 32), b);
+		_mm256_stream_si256((__m256i *)(dst + x + 64), c);
+		_mm256_stream_si256((__m256i *)(dst + x + 96), d);
+	}
+	for (; x + 32 <= bytes; x += 32)
+		_mm256_stream_si256((__m256i *)(dst + x), _mm256_loadu_si256((const __m256i *)(src + x)));
+	memcpy(dst + x, src + x, bytes - x);
+}
+
+//dst must be 32 byte aligned
+INGEST_TARGET("avx2")
+static unsigned copy_row16_avx2(uint8_t *dst, const uint8_t *src, int bytes, uint16_t max)
+{
+	const __m256i vmax = _mm256_set1_epi16((short)max);
+	const __m256i high = _mm256_set1_epi16((short)(uint16_t)~max);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i over = zero;
+	int x = 0;
+	for (; x + 32 <= bytes; x += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(src + x));
+		__m256i h = _mm256_and_si256(v, high);
+		over = _mm256_or_si256(over, h);
+		_mm256_stream_si256((__m256i *)(dst + x), _mm256_blendv_epi8(vmax, v, _mm256_cmpeq_epi16(h, zero)));
+	}
+	unsigned tail = copy_row16_c(dst + x, src + x, bytes - x, max);
+	return tail | !_mm256_testz_si256(over, over);
+}
+#endif
+
+/*
+ * Reads raw frames of Layout into frames whose rows are aligned to
+ * Align bytes, see frame_pool.h.
+ */
+template <typename Layout, int Align>
+class Ingest : public FrameReader
+{
+private:
+	static_assert(Align >= 32 && (Align & (Align - 1)) == 0,
+		      "rows must be aligned for 32 byte stores");
+
+	std::vector<uint8_t> d_stage;
+	int         d_plane_bytes[Layout::planes];	// in the raw frame
+	int         d_stride[Layout::planes];	// of the raw frame
+	int         d_offset[Layout::planes];	// of the window in the plane
+	int         d_row_bytes[Layout::planes];	// of the window
+	int         d_rows[Layout::planes];
+	int         d_pad_bytes[Layout::planes];	// repeated after every row
+	int         d_pad_rows[Layout::planes];	// last row repeated
+	RowCopy     d_copy;
+	RowCopy16   d_copy16;
+	const char *d_name;
+	bool        d_streaming;
+	int         d_clipped;
+
+	//repeat the sample at last over bytes of dst, clipped like the row
+	static void pad_row(uint8_t *dst, const uint8_t *last, int bytes, uint16_t max) {
+		if (Layout::depth <= 8) {
+			memset(dst, *last, bytes);
+			return;
+		}
+		uint16_t v = (uint16_t)(last[0] | last[1] << 8);
+		if (v & ~max)
+			v = max;
+		for (int x = 0; x + 1 < bytes; x += 2) {
+			dst[x] = (uint8_t)v;
+			dst[x + 1] = (uint8_t)(v >> 8);
+		}
+	}
+
+public:
+	Ingest(int width, int height)
+		: d_stage(Layout::frame_bytes(width, height)), d_copy(copy_row_c), d_copy16(copy_row16_c),
+		  d_name("C"), d_streaming(false), d_clipped(0) {
+		for (int p = 0; p < Layout::planes; p++) {
+			d_stride[p] = d_row_bytes[p] = Layout::row_bytes(p, width);
+			d_rows[p] = Layout::height(p, height);
+			d_plane_bytes[p] = d_stride[p] * d_rows[p];
+			d_offset[p] = d_pad_bytes[p] = d_pad_rows[p] = 0;
+		}
+#if INGEST_X86
+		int flags = av_get_cpu_flags();
+		if (flags & AV_CPU_FLAG_AVX2) {
+			d_copy = copy_row_avx2;
+			d_copy16 = copy_row16_avx2;
+			d_name = "AVX2";
+			d_streaming = true;
+		} else if (flags & AV_CPU_FLAG_SSE2) {
+			d_copy = copy_row_sse2;
+			d_copy16 = copy_row16_sse2;
+			d_name = "SSE2";
+			d_streaming = true;
+		}
+#endif
+	}
+
+	const char *name() const { return d_name; }
+	int clipped() const { return d_clipped; }
+	static size_t frame_bytes(int width, int height) { return Layout::frame_bytes(width, height); }
+
+	//frames must be window.out_width x window.out_height from now on
+	bool crop(const CropWindow &window) {
+		for (int p = 0; p < Layout::planes; p++) {
+			int x = Layout::width(p, window.x), y = Layout::height(p, window.y);
+			d_offset[p] = y * d_stride[p] + x * Layout::sample_bytes;
+			d_row_bytes[p] = Layout::row_bytes(p, window.width);
+			d_rows[p] = Layout::height(p, window.height);
+			d_pad_bytes[p] = Layout::row_bytes(p, window.out_width) - d_row_bytes[p];
+			d_pad_rows[p] = Layout::height(p, window.out_height) - d_rows[p];
+		}
+		return true;
+	}
+
+	//copy one packed raw frame from src into frame
+	void copy(const uint8_t *src, AVFrame *frame) {
+		unsigned over = 0;
+		const uint16_t max = (uint16_t)((1 << Layout::depth) - 1);
+		for (int p = 0; p < Layout::planes; p++) {
+			uint8_t *dst = frame->data[p];
+			int stride = frame->linesize[p];
+			//unaligned rows, e.g. a frame not from the pool, take the plain copy
+			bool aligned = ((uintptr_t)dst | (uintptr_t)stride) % Align == 0;
+			RowCopy row = aligned ? d_copy : copy_row_c;
+			RowCopy16 row16 = aligned ? d_copy16 : copy_row16_c;
+			const uint8_t *s = src + d_offset[p];
+			for (int y = 0; y < d_rows[p] + d_pad_rows[p]; y++) {
+				if (Layout::depth > 8)
+					over |= row16(dst, s, d_row_bytes[p], max);
+				else
+					row(dst, s, d_row_bytes[p]);
+				if (d_pad_bytes[p])
+					pad_row(dst + d_row_bytes[p], s + d_row_bytes[p] - Layout::sample_bytes, d_pad_bytes[p], max);
+				dst += stride;
+				//past the window the last row is repeated
+				if (y + 1 < d_rows[p])
+					s += d_stride[p];
+			}
+			src += d_plane_bytes[p];
+		}
+		if (over)
+			d_clipped++;
+#if INGEST_X86
+		if (d_streaming)
+			_mm_sfence();	// the stores must be visible before the frame changes hands
+#endif
+	}
+
+	//read the next raw frame into frame, false on a short read
+	bool read(FILE *fp, AVFrame *frame) {
+		if (fread(&d_stage[0], 1, d_stage.size(), fp) != d_stage.size())
+			return false;
+		copy(&d_stage[0], frame);
+		return true;
+	}
+};
+
+/*
+ * An Ingest for a planar YUV format read as it is, NULL for formats
+ * that need converting.
+ */
+template <int Align>
+static FrameReader *ingest_for(AVPixelFormat format, int width, int height)
+{
+	switch (format) {
+	case AV_PIX_FMT_YUV420P:     return new Ingest<LayoutYUV420P, Align>(width, height);
+	case AV_PIX_FMT_YUV422P:     return new Ingest<LayoutYUV422P, Align>(width, height);
+	case AV_PIX_FMT_YUV444P:     return new Ingest<LayoutYUV444P, Align>(width, height);
+	case AV_PIX_FMT_YUV420P10LE: return new Ingest<LayoutYUV420P10, Align>(width, height);
+	case AV_PIX_FMT_YUV422P10LE: return new Ingest<LayoutYUV422P10, Align>(width, height);
+	case AV_PIX_FMT_YUV444P10LE: return new Ingest<LayoutYUV444P10, Align>(width, height);
+	default:                     return NULL;
+	}
+}
+
+#endif
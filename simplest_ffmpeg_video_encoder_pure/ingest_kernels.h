@@ -0,0 +1,531 @@
+/**
+ * NV12, BGRA, 4:2:2 and 4:4:4 ingest kernels for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after ingest.h
+ * and frame_pool.h.
+ *
+ * The input formats seen most often get dedicated kernels instead of
+ * the libswscale stage (convert_stage.h). The reader converts them on
+ * its way from the staging buffer into the pooled 4:2:0 frame, so the
+ * data passes through memory once, like a plain raw frame:
+ *
+ * 	NV12	luma rows are copied, the interleaved chroma rows are
+ * 		split into U and V with byte shuffles, both with
+ * 		non-temporal stores
+ *
+ * 	BGRA	rows are converted in pairs: luma of both rows, and
+ * 		chroma of the 2x2 average, BT.601 limited range in
+ * 		8-bit fixed point:
+ *
+ * 		Y = (( 66 R + 129 G +  25 B + 128) >> 8) +  16
+ * 		U = ((-38 R -  74 G + 112 B + 128) >> 8) + 128
+ * 		V = ((112 R -  94 G -  18 B + 128) >> 8) + 128
+ *
+ * 	4:2:2	luma rows are copied, chroma rows are averaged in
+ * 		pairs, which puts the sample halfway between them,
+ * 		where 4:2:0 chroma sits
+ *
+ * 	4:4:4	chroma rows are averaged in pairs as well and then
+ * 		filtered [1 2 1] / 4 around every even column, where
+ * 		4:2:0 chroma is co-sited (MPEG-2 and H.264 siting)
+ *
+ * Broadcast feeds arrive in 4:2:2, and decimating here costs nothing
+ * but the arithmetic, where converting them beforehand would write
+ * and read every frame once more.
+ *
+ * Every kernel has a C reference; the SSE4 and AVX2 versions compute
+ * exactly the same bytes and are picked from av_get_cpu_flags().
+ * "--bench-kernels" checks that and reports each kernel's throughput.
+ */
+
+#ifndef INGEST_KERNELS_H
+#define INGEST_KERNELS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
+struct IngestKernels
+{
+	const char *name;
+	RowCopy     copy_row;
+	//split width interleaved UV pairs into u and v
+	void (*split_uv)(uint8_t *u, uint8_t *v, const uint8_t *uv, int width);
+	//convert a pair of BGRA rows of width pixels, width/2 rounded up chroma samples
+	void (*bgra_rows)(uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+			  const uint8_t *s0, const uint8_t *s1, int width);
+	//rounded average of rows a and b, width samples
+	void (*avg_rows)(uint8_t *dst, const uint8_t *a, const uint8_t *b, int width);
+	//average of rows a and b filtered down to (width + 1) / 2 samples
+	void (*decimate_rows)(uint8_t *dst, const uint8_t *a, const uint8_t *b, int width);
+};
+
+static void split_uv_c(uint8_t *u, uint8_t *v, const uint8_t *uv, int width)
+{
+	for (int x = 0; x < width; x++) {
+		u[x] = uv[2 * x];
+		v[x] = uv[2 * x + 1];
+	}
+}
+
+static inline uint8_t bgra_y(int b, int g, int r)
+{
+	return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline uint8_t bgra_u(int b, int g, int r)
+{
+	return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline uint8_t bgra_v(int b, int g, int r)
+{
+	return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+static void bgra_rows_c(uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+			const uint8_t *s0, const uint8_t *s1, int width)
+{
+	for (int x = 0; x < width; x += 2) {
+		const uint8_t *p0 = s0 + 4 * x, *p1 = s1 + 4 * x;
+		//a missing right neighbour counts as the pixel itself
+		int n = x + 1 < width ? 4 : 0;
+		y0[x] = bgra_y(p0[0], p0[1], p0[2]);
+		y1[x] = bgra_y(p1[0], p1[1], p1[2]);
+		if (n) {
+			y0[x + 1] = bgra_y(p0[4], p0[5], p0[6]);
+			y1[x + 1] = bgra_y(p1[4], p1[5], p1[6]);
+		}
+		int b = (p0[0] + p0[n] + p1[0] + p1[n] + 2) >> 2;
+		int g = (p0[1] + p0[n + 1] + p1[1] + p1[n + 1] + 2) >> 2;
+		int r = (p0[2] + p0[n + 2] + p1[2] + p1[n + 2] + 2) >> 2;
+		u[x / 2] = bgra_u(b, g, r);
+		v[x / 2] = bgra_v(b, g, r);
+	}
+}
+
+static void avg_rows_c(uint8_t *dst, const uint8_t *a, const uint8_t *b, int width)
+{
+	for (int x = 0; x < width; x++)
+		dst[x] = (uint8_t)((a[x] + b[x] + 1) >> 1);
+}
+
+static inline int avg_at(const uint8_t *a, const uint8_t *b, int x)
+{
+	return (a[x] + b[x] + 1) >> 1;
+}
+
+//decimate_rows from output sample x on, the edge samples repeated
+static void decimate_rows_from_c(uint8_t *dst, const uint8_t *a, const uint8_t *b, int width, int x)
+{
+	for (; 2 * x < width; x++) {
+		int c = 2 * x, l = c ? c - 1 : 0, r = c + 1 < width ? c + 1 : c;
+		dst[x] = (uint8_t)((avg_at(a, b, l) + 2 * avg_at(a, b, c) + avg_at(a, b, r) + 2) >> 2);
+	}
+}
+
+static void decimate_rows_c(uint8_t *dst, const uint8_t *a, const uint8_t *b, int width)
+{
+	decimate_rows_from_c(dst, a, b, width, 0);
+}
+
+static const IngestKernels ingest_kernels_c = { "C", copy_row_c, split_uv_c, bgra_rows_c, avg_rows_c, decimate_rows_c };
+
+#if INGEST_X86
+//u and v must be 16 byte aligned
+INGEST_TARGET("sse4.1")
+static void split_uv_sse4(uint8_t *u, uint8_t *v, const uint8_t *uv, int width)
+{
+	const __m128i mask = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(uv + 2 * x)), mask);
+		__m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(uv + 2 * x + 16)), mask);
+		_mm_stream_si128((__m128i *)(u + x), _mm_unpacklo_epi64(a, b));
+		_mm_stream_si128((__m128i *)(v + x), _mm_unpackhi_epi64(a, b));
+	}
+	split_uv_c(u + x, v + x, uv + 2 * x, width - x);
+}
+
+//weighted sums of 4 BGRA pixels, one 32-bit lane each
+INGEST_TARGET("sse4.1")
+static inline __m128i bgra_dot4_sse4(__m128i px, __m128i k)
+{
+	const __m128i zero = _mm_setzero_si128();
+	return _mm_hadd_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(px, zero), k),
+			      _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), k));
+}
+
+//rounded 2x2 averages of 4 pixels of rows a and b, 16-bit BGRA of 2 pixels
+INGEST_TARGET("sse4.1")
+static inline __m128i bgra_avg4_sse4(__m128i a, __m128i b)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+	__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+	lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+	hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+	return _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_set1_epi16(2)), 2);
+}
+
+//8 bytes from two sets of 4 sums: (sum + 128) >> 8, plus offset
+INGEST_TARGET("sse4.1")
+static inline __m128i bgra_pack8_sse4(__m128i a, __m128i b, int offset)
+{
+	const __m128i round = _mm_set1_epi32(128);
+	a = _mm_srai_epi32(_mm_add_epi32(a, round), 8);
+	b = _mm_srai_epi32(_mm_add_epi32(b, round), 8);
+	__m128i w = _mm_add_epi16(_mm_packs_epi32(a, b), _mm_set1_epi16(offset));
+	return _mm_packus_epi16(w, w);
+}
+
+INGEST_TARGET("sse4.1")
+static void bgra_rows_sse4(uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+			   const uint8_t *s0, const uint8_t *s1, int width)
+{
+	const __m128i ky = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+	const __m128i ku = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+	const __m128i kv = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+	int x = 0;
+	for (; x + 8 <= width; x += 8) {
+		__m128i a0 = _mm_loadu_si128((const __m128i *)(s0 + 4 * x));
+		__m128i a1 = _mm_loadu_si128((const __m128i *)(s0 + 4 * x + 16));
+		__m128i b0 = _mm_loadu_si128((const __m128i *)(s1 + 4 * x));
+		__m128i b1 = _mm_loadu_si128((const __m128i *)(s1 + 4 * x + 16));
+		_mm_storel_epi64((__m128i *)(y0 + x), bgra_pack8_sse4(bgra_dot4_sse4(a0, ky), bgra_dot4_sse4(a1, ky), 16));
+		_mm_storel_epi64((__m128i *)(y1 + x), bgra_pack8_sse4(bgra_dot4_sse4(b0, ky), bgra_dot4_sse4(b1, ky), 16));
+		__m128i c0 = bgra_avg4_sse4(a0, b0);
+		__m128i c1 = bgra_avg4_sse4(a1, b1);
+		__m128i cu = _mm_hadd_epi32(_mm_madd_epi16(c0, ku), _mm_madd_epi16(c1, ku));
+		__m128i cv = _mm_hadd_epi32(_mm_madd_epi16(c0, kv), _mm_madd_epi16(c1, kv));
+		int su = _mm_cvtsi128_si32(bgra_pack8_sse4(cu, cu, 128));
+		int sv = _mm_cvtsi128_si32(bgra_pack8_sse4(cv, cv, 128));
+		memcpy(u + x / 2, &su, 4);
+		memcpy(v + x / 2, &sv, 4);
+	}
+	bgra_rows_c(y0 + x, y1 + x, u + x / 2, v + x / 2, s0 + 4 * x, s1 + 4 * x, width - x);
+}
+
+//dst must be 16 byte aligned
+INGEST_TARGET("sse4.1")
+static void avg_rows_sse4(uint8_t *dst, const uint8_t *a, const uint8_t *b, int width)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+		_mm_stream_si128((__m128i *)(dst + x), _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(a + x)),
+								    _mm_loadu_si128((const __m128i *)(b + x))));
+	avg_rows_c(dst + x, a + x, b + x, width - x);
+}
+
+//[1 2 1] / 4 around the even samples of cur, prev holds the samples two before cur's
+INGEST_TARGET("sse4.1")
+static inline __m128i decimate8_sse4(__m128i cur, __m128i prev)
+{
+	__m128i c = _mm_and_si128(cur, _mm_set1_epi16(0x00ff));
+	__m128i r = _mm_srli_epi16(cur, 8);
+	__m128i l = _mm_srli_epi16(prev, 8);
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(l, r), _mm_add_epi16(_mm_add_epi16(c, c), _mm_set1_epi16(2))), 2);
+}
+
+//dst must be 16 byte aligned, x a multiple of 16
+INGEST_TARGET("sse4.1")
+static void decimate_rows_from_sse4(uint8_t *dst, const uint8_t *a, const uint8_t *b, int width, int x)
+{
+	//the sample left of the block in the top byte, the edge one at first
+	__m128i last = _mm_set1_epi8((char)avg_at(a, b, x ? 2 * x - 1 : 0));
+	for (; 2 * x + 32 <= width; x += 16) {
+		__m128i c0 = _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(a + 2 * x)),
+					  _mm_loadu_si128((const __m128i *)(b + 2 * x)));
+		__m128i c1 = _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(a + 2 * x + 16)),
+					  _mm_loadu_si128((const __m128i *)(b + 2 * x + 16)));
+		__m128i lo = decimate8_sse4(c0, _mm_alignr_epi8(c0, last, 14));
+		__m128i hi = decimate8_sse4(c1, _mm_alignr_epi8(c1, c0, 14));
+		_mm_stream_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+		last = c1;
+	}
+	decimate_rows_from_c(dst, a, b, width, x);
+}
+
+INGEST_TARGET("sse4.1")
+static void decimate_rows_sse4(uint8_t *dst, const uint8_t *a, const uint8_t *b, int width)
+{
+	decimate_rows_from_sse4(dst, a, b, width, 0);
+}
+
+static const IngestKernels ingest_kernels_sse4 = { "SSE4", copy_row_sse2, split_uv_sse4, bgra_rows_sse4,
+						   avg_rows_sse4, decimate_rows_sse4 };
+
+//u and v must be 32 byte aligned
+INGEST_TARGET("avx2")
+static void split_uv_avx2(uint8_t *u, uint8_t *v, const uint8_t *uv, int width)
+{
+	const __m256i mask = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,
+					      0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+	int x = 0;
+	for (; x + 32 <= width; x += 32) {
+		__m256i a = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(uv + 2 * x)), mask);
+		__m256i b = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(uv + 2 * x + 32)), mask);
+		//each lane holds 8 U then 8 V, gather the U and V halves
+		a = _mm256_permute4x64_epi64(a, _MM_SHUFFLE(3, 1, 2, 0));
+		b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_stream_si256((__m256i *)(u + x), _mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_stream_si256((__m256i *)(v + x), _mm256_permute2x128_si256(a, b, 0x31));
+	}
+	split_uv_sse4(u + x, v + x, uv + 2 * x, width - x);
+}
+
+//weighted sums of 8 BGRA pixels, in order
+INGEST_TARGET("avx2")
+static inline __m256i bgra_dot8_avx2(__m256i px, __m256i k)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	return _mm256_hadd_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi8(px, zero), k),
+				 _mm256_madd_epi16(_mm256_unpackhi_epi8(px, zero), k));
+}
+
+//rounded 2x2 averages of 8 pixels of rows a and b; pixel pairs 0 1 | 2 3 by lane
+INGEST_TARGET("avx2")
+static inline __m256i bgra_avg8_avx2(__m256i a, __m256i b)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+	__m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+	lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+	hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+	return _mm256_srli_epi16(_mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_set1_epi16(2)), 2);
+}
+
+//8 bytes from 8 sums: (sum + 128) >> 8, plus offset
+INGEST_TARGET("avx2")
+static inline __m128i bgra_pack8_avx2(__m256i s, int offset)
+{
+	s = _mm256_srai_epi32(_mm256_add_epi32(s, _mm256_set1_epi32(128)), 8);
+	__m128i w = _mm_packs_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+	return _mm_add_epi16(w, _mm_set1_epi16(offset));
+}
+
+INGEST_TARGET("avx2")
+static void bgra_rows_avx2(uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+			   const uint8_t *s0, const uint8_t *s1, int width)
+{
+	const __m256i ky = _mm256_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0, 25, 129, 66, 0, 25, 129, 66, 0);
+	const __m256i ku = _mm256_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0, 112, -74, -38, 0, 112, -74, -38, 0);
+	const __m256i kv = _mm256_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0, -18, -94, 112, 0, -18, -94, 112, 0);
+	//hadd of two averaged halves gives chroma 0 1 4 5 | 2 3 6 7
+	const __m256i order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m256i a0 = _mm256_loadu_si256((const __m256i *)(s0 + 4 * x));
+		__m256i a1 = _mm256_loadu_si256((const __m256i *)(s0 + 4 * x + 32));
+		__m256i b0 = _mm256_loadu_si256((const __m256i *)(s1 + 4 * x));
+		__m256i b1 = _mm256_loadu_si256((const __m256i *)(s1 + 4 * x + 32));
+		_mm_storeu_si128((__m128i *)(y0 + x), _mm_packus_epi16(bgra_pack8_avx2(bgra_dot8_avx2(a0, ky), 16),
+									bgra_pack8_avx2(bgra_dot8_avx2(a1, ky), 16)));
+		_mm_storeu_si128((__m128i *)(y1 + x), _mm_packus_epi16(bgra_pack8_avx2(bgra_dot8_avx2(b0, ky), 16),
+									bgra_pack8_avx2(bgra_dot8_avx2(b1, ky), 16)));
+		__m256i c0 = bgra_avg8_avx2(a0, b0);
+		__m256i c1 = bgra_avg8_avx2(a1, b1);
+		__m256i cu = _mm256_permutevar8x32_epi32(_mm256_hadd_epi32(_mm256_madd_epi16(c0, ku), _mm256_madd_epi16(c1, ku)), order);
+		__m256i cv = _mm256_permutevar8x32_epi32(_mm256_hadd_epi32(_mm256_madd_epi16(c0, kv), _mm256_madd_epi16(c1, kv)), order);
+		__m128i pu = bgra_pack8_avx2(cu, 128);
+		__m128i pv = bgra_pack8_avx2(cv, 128);
+		_mm_storel_epi64((__m128i *)(u + x / 2), _mm_packus_epi16(pu, pu));
+		_mm_storel_epi64((__m128i *)(v + x / 2), _mm_packus_epi16(pv, pv));
+	}
+	bgra_rows_sse4(y0 + x, y1 + x, u + x / 2, v + x / 2, s0 + 4 * x, s1 + 4 * x, width - x);
+}
+
+//dst must be 32 byte aligned
+INGEST_TARGET("avx2")
+static void avg_rows_avx2(uint8_t *dst, const uint8_t *a, const uint8_t *b, int width)
+{
+	int x = 0;
+	for (; x + 32 <= width; x += 32)
+		_mm256_stream_si256((__m256i *)(dst + x), _mm256_avg_epu8(_mm256_loadu_si256((const __m256i *)(a + x)),
+									  _mm256_loadu_si256((const __m256i *)(b + x))));
+	avg_rows_sse4(dst + x, a + x, b + x, width - x);
+}
+
+//the 4:4:4 filter needs lane crossing shuffles in AVX2 and ran slower than SSE4, so SSE4 it is
+static const IngestKernels ingest_kernels_avx2 = { "AVX2", copy_row_avx2, split_uv_avx2, bgra_rows_avx2,
+						   avg_rows_avx2, decimate_rows_sse4 };
+#endif
+
+//the best kernels for cpu_flags
+static const IngestKernels *ingest_kernels_for(int cpu_flags)
+{
+#if INGEST_X86
+	if (cpu_flags & AV_CPU_FLAG_AVX2)
+		return &ingest_kernels_avx2;
+	if (cpu_flags & AV_CPU_FLAG_SSE4)
+		return &ingest_kernels_sse4;
+#endif
+	(void)cpu_flags;
+	return &ingest_kernels_c;
+}
+
+/*
+ * Reads NV12, BGRA, YUV422P or YUV444P frames into 4:2:0 frames whose
+ * rows are aligned to Align bytes, see frame_pool.h.
+ */
+template <int Align>
+class KernelIngest : public FrameReader
+{
+private:
+	static_assert(Align >= 32 && (Align & (Align - 1)) == 0,
+		      "rows must be aligned for 32 byte stores");
+
+	AVPixelFormat        d_format;
+	int                  d_width;
+	int                  d_height;
+	const IngestKernels *d_kernels;
+	std::vector<uint8_t> d_stage;
+	std::vector<uint8_t> d_spare;	// luma row below an odd height
+
+public:
+	static bool supports(AVPixelFormat format) {
+		return format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_BGRA ||
+		       format == AV_PIX_FMT_YUV422P || format == AV_PIX_FMT_YUV444P;
+	}
+
+	//kernels: NULL for the best ones for this CPU
+	KernelIngest(AVPixelFormat format, int width, int height, const IngestKernels *kernels = NULL)
+		: d_format(format), d_width(width), d_height(height),
+		  d_kernels(kernels ? kernels : ingest_kernels_for(av_get_cpu_flags())),
+		  d_stage(frame_bytes(format, width, height)), d_spare(width) {}
+
+	const char *name() const { return d_kernels->name; }
+
+	//size of one packed source frame
+	static size_t frame_bytes(AVPixelFormat format, int width, int height) {
+		if (format == AV_PIX_FMT_NV12)
+			return (size_t)width * height + (size_t)((width + 1) / 2) * 2 * ((height + 1) / 2);
+		if (format == AV_PIX_FMT_YUV422P)
+			return (size_t)width * height + (size_t)((width + 1) / 2) * 2 * height;
+		if (format == AV_PIX_FMT_YUV444P)
+			return (size_t)width * height * 3;
+		return (size_t)width * height * 4;
+	}
+
+	//convert one packed source frame from src into frame
+	void copy(const uint8_t *src, AVFrame *frame) {
+		int cw = (d_width + 1) / 2, ch = (d_height + 1) / 2;
+		if (d_format != AV_PIX_FMT_BGRA) {
+			//the kernels stream into aligned rows, anything else takes the C path
+			bool aligned = true;
+			for (int p = 0; p < 3; p++)
+				aligned = aligned && ((uintptr_t)frame->data[p] | (uintptr_t)frame->linesize[p]) % Align == 0;
+			const IngestKernels *k = aligned ? d_kernels : &ingest_kernels_c;
+			for (int y = 0; y < d_height; y++, src += d_width)
+				k->copy_row(frame->data[0] + y * frame->linesize[0], src, d_width);
+			if (d_format == AV_PIX_FMT_NV12) {
+				for (int y = 0; y < ch; y++, src += cw * 2)
+					k->split_uv(frame->data[1] + y * frame->linesize[1],
+						    frame->data[2] + y * frame->linesize[2], src, cw);
+			} else {
+				//source chroma rows: 4:2:2 halved already, 4:4:4 full width
+				bool full = d_format == AV_PIX_FMT_YUV444P;
+				int sw = full ? d_width : cw;
+				for (int p = 1; p < 3; p++, src += (size_t)sw * d_height) {
+					for (int y = 0; y < ch; y++) {
+						const uint8_t *a = src + (size_t)(2 * y) * sw;
+						const uint8_t *b = 2 * y + 1 < d_height ? a + sw : a;
+						uint8_t *dst = frame->data[p] + y * frame->linesize[p];
+						if (full)
+							k->decimate_rows(dst, a, b, d_width);
+						else
+							k->avg_rows(dst, a, b, cw);
+					}
+				}
+			}
+#if INGEST_X86
+			if (k != &ingest_kernels_c)
+				_mm_sfence();	// the stores must be visible before the frame changes hands
+#endif
+			return;
+		}
+		for (int y = 0; y < ch; y++) {
+			const uint8_t *s0 = src + (size_t)(2 * y) * d_width * 4;
+			bool pair = 2 * y + 1 < d_height;
+			d_kernels->bgra_rows(frame->data[0] + 2 * y * frame->linesize[0],
+					     pair ? frame->data[0] + (2 * y + 1) * frame->linesize[0] : &d_spare[0],
+					     frame->data[1] + y * frame->linesize[1],
+					     frame->data[2] + y * frame->linesize[2],
+					     s0, pair ? s0 + d_width * 4 : s0, d_width);
+		}
+	}
+
+	//read the next source frame into frame, false on a short read
+	bool read(FILE *fp, AVFrame *frame) {
+		if (fread(&d_stage[0], 1, d_stage.size(), fp) != d_stage.size())
+			return false;
+		copy(&d_stage[0], frame);
+		return true;
+	}
+};
+
+/*
+ * --bench-kernels: convert a 1920x1080 frame with every kernel set the
+ * CPU supports, check the result against the C reference and print
+ * the throughput in source bytes.
+ */
+static int run_kernel_bench()
+{
+	const int w = 1920, h = 1080;
+	const AVPixelFormat formats[] = { AV_PIX_FMT_NV12, AV_PIX_FMT_BGRA, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P };
+	std::vector<const IngestKernels *> sets(1, &ingest_kernels_c);
+#if INGEST_X86
+	int flags = av_get_cpu_flags();
+	if (flags & AV_CPU_FLAG_SSE4)
+		sets.push_back(&ingest_kernels_sse4);
+	if (flags & AV_CPU_FLAG_AVX2)
+		sets.push_back(&ingest_kernels_avx2);
+#endif
+	FramePool frames(w, h, AV_PIX_FMT_YUV420P, 32);
+	AVFrame *ref = frames.get(), *out = frames.get();
+	if (!ref || !out) {
+		printf("Could not allocate video frame\n");
+		return -1;
+	}
+	int failures = 0;
+	for (int f = 0; f < (int)(sizeof(formats) / sizeof(formats[0])); f++) {
+		size_t bytes = KernelIngest<32>::frame_bytes(formats[f], w, h);
+		std::vector<uint8_t> src(bytes);
+		unsigned seed = 1;
+		for (size_t k = 0; k < bytes; k++) {
+			seed = seed * 1103515245 + 12345;
+			src[k] = (uint8_t)(seed >> 16);
+		}
+		const char *fmt = av_get_pix_fmt_name(formats[f]);
+		KernelIngest<32>(formats[f], w, h, &ingest_kernels_c).copy(&src[0], ref);
+		for (size_t s = 0; s < sets.size(); s++) {
+			KernelIngest<32> ingest(formats[f], w, h, sets[s]);
+			ingest.copy(&src[0], out);
+			bool same = true;
+			for (int p = 0; p < 3; p++) {
+				int pw = p ? (w + 1) / 2 : w, ph = p ? (h + 1) / 2 : h;
+				for (int y = 0; y < ph; y++)
+					same = same && !memcmp(ref->data[p] + y * ref->linesize[p],
+							       out->data[p] + y * out->linesize[p], pw);
+			}
+			int runs = 0;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			double secs = 0;
+			while (secs < 0.25) {
+				ingest.copy(&src[0], out);
+				runs++;
+				secs = std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::steady_clock::now() - start).count() / 1e6;
+			}
+			printf("Kernel %-7s %-4s: %6.2f GB/s, %7.1f frames/s, %s\n", fmt, sets[s]->name,
+			       bytes * (double)runs / secs / 1e9, runs / secs, same ? "matches C" : "DIFFERS FROM C");
+			failures += !same;
+		}
+	}
+	frames.put(ref);
+	frames.put(out);
+	return failures ? -1 : 0;
+}
+
+#endif
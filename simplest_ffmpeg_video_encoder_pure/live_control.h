@@ -0,0 +1,165 @@
+/**
+ * Live control channel for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers.
+ *
+ * A FIFO accepts one command per line while the encoder runs:
+ *
+ * 	bitrate <bps>	new target bitrate
+ * 	maxrate <bps>	new VBV maximum rate
+ * 	bufsize <bits>	new VBV buffer size
+ * 	idr		force an IDR on the next frame
+ *
+ * e.g. echo "bitrate 800000" > /tmp/simplest_encoder.ctl
+ *
+ * A reader thread parses the commands. The encoding thread picks them
+ * up with apply() before each frame, which is the only place the codec
+ * context is touched, so no locking is needed around libavcodec. The
+ * libx264 wrapper compares bit_rate, rc_max_rate and rc_buffer_size
+ * with its own parameters on every frame and calls x264_encoder_reconfig()
+ * when they differ, so the encoder is never reopened.
+ */
+
+#ifndef LIVE_CONTROL_H
+#define LIVE_CONTROL_H
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+class LiveControl
+{
+private:
+    std::mutex        d_mutex;
+    std::thread       d_thread;
+    std::atomic<bool> d_stop;
+    int               d_fd;
+    // pending changes, -1 when unchanged
+    int64_t           d_bitrate;
+    int64_t           d_maxrate;
+    int64_t           d_bufsize;
+    bool              d_idr;
+
+    void parse(const std::string &line) {
+        char cmd[16];
+        long long value = 0;
+        int n = sscanf(line.c_str(), "%15s %lld", cmd, &value);
+        if (n < 1)
+            return;
+        std::unique_lock<std::mutex> lock(this->d_mutex);
+        if (!strcmp(cmd, "bitrate") && n == 2 && value > 0)
+            d_bitrate = value;
+        else if (!strcmp(cmd, "maxrate") && n == 2 && value >= 0)
+            d_maxrate = value;
+        else if (!strcmp(cmd, "bufsize") && n == 2 && value >= 0)
+            d_bufsize = value;
+        else if (!strcmp(cmd, "idr"))
+            d_idr = true;
+        else
+            printf("Control: unknown command \"%s\"\n", line.c_str());
+    }
+
+#ifndef _WIN32
+    void run() {
+        std::string line;
+        char buf[256];
+        while (!d_stop) {
+            struct pollfd pfd;
+            pfd.fd = d_fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            //wake up regularly to notice stop()
+            if (poll(&pfd, 1, 100) <= 0)
+                continue;
+            ssize_t n = read(d_fd, buf, sizeof(buf));
+            for (ssize_t k = 0; k < n; k++) {
+                if (buf[k] == '\n') {
+                    parse(line);
+                    line.clear();
+                } else {
+                    line += buf[k];
+                }
+            }
+        }
+    }
+#endif
+
+public:
+    LiveControl(): d_stop(false), d_fd(-1), d_bitrate(-1), d_maxrate(-1),
+                   d_bufsize(-1), d_idr(false) {}
+    ~LiveControl() { stop(); }
+
+    bool start(const char *path) {
+#ifdef _WIN32
+        printf("Control: FIFOs are not supported on Windows\n");
+        return false;
+#else
+        if (mkfifo(path, 0666) < 0 && errno != EEXIST) {
+            printf("Control: could not create %s\n", path);
+            return false;
+        }
+        //O_RDWR keeps a writer open, so reads never hit EOF between clients
+        d_fd = open(path, O_RDWR | O_NONBLOCK);
+        if (d_fd < 0) {
+            printf("Control: could not open %s\n", path);
+            return false;
+        }
+        d_thread = std::thread(&LiveControl::run, this);
+        printf("Control: listening on %s\n", path);
+        return true;
+#endif
+    }
+
+    void stop() {
+        d_stop = true;
+        if (d_thread.joinable())
+            d_thread.join();
+#ifndef _WIN32
+        if (d_fd >= 0)
+            close(d_fd);
+#endif
+        d_fd = -1;
+    }
+
+    /*
+     * Called by the encoding thread right before encoding frame.
+     * Rate changes go to the context, a pending IDR to the frame.
+     */
+    void apply(AVCodecContext *ctx, AVFrame *frame) {
+        std::unique_lock<std::mutex> lock(this->d_mutex);
+        if (d_bitrate >= 0) {
+            ctx->bit_rate = (int)d_bitrate;
+            printf("Control: bitrate %d\n", ctx->bit_rate);
+            d_bitrate = -1;
+        }
+        if (d_maxrate >= 0) {
+            ctx->rc_max_rate = (int)d_maxrate;
+            printf("Control: maxrate %d\n", ctx->rc_max_rate);
+            d_maxrate = -1;
+        }
+        if (d_bufsize >= 0) {
+            ctx->rc_buffer_size = (int)d_bufsize;
+            printf("Control: bufsize %d\n", ctx->rc_buffer_size);
+            d_bufsize = -1;
+        }
+        if (d_idr && frame) {
+            frame->pict_type = AV_PICTURE_TYPE_I;
+            printf("Control: IDR at frame %lld\n", (long long)frame->pts);
+            d_idr = false;
+        }
+    }
+};
+
+#endif
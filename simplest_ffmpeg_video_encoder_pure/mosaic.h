@@ -0,0 +1,536 @@
+/**
+ * Mosaic input for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers, libswscale's included, task_pool.h and
+ * frame_pool.h.
+ *
+ * Composites several raw YUV420P inputs into every frame the encoders
+ * get, for monitoring walls and picture-in-picture, without a
+ * compositing process in front of the encoder. The input, a .mosaic
+ * file or any file with --mosaic, names the canvas and places every
+ * input on it, one per line:
+ *
+ * 	canvas <width>x<height> [fps]
+ * 	<input> <width>x<height> <x>,<y> <w>x<h>
+ *
+ * A 2x2 wall of 720p cameras, and picture-in-picture:
+ *
+ * 	canvas 1920x1080 25			canvas 1920x1080
+ * 	cam1.yuv 1280x720 0,0 960x540		main.yuv 1920x1080 0,0 1920x1080
+ * 	cam2.yuv 1280x720 960,0 960x540		guest.yuv 1280x720 1392,756 480x270
+ * 	cam3.yuv 1280x720 0,540 960x540
+ * 	cam4.yuv 1280x720 960,540 960x540
+ *
+ * Lines starting with '#' are ignored. Positions and sizes are even,
+ * for the chroma planes. Later inputs are drawn over earlier ones.
+ * Inputs are files or FIFOs fed by live sources.
+ *
+ * Every input has a reader thread of its own, which reads up to
+ * MOSAIC_QUEUE frames ahead into a frame pool with unpadded rows. For
+ * every output frame the reading stage takes the next frame of each
+ * input and blits the inputs into the encoders' frame as tasks on the
+ * pool, scaled by libswscale or copied row by row if the size is
+ * unchanged. Tiles that overlap an earlier tile wait for it, all
+ * others run side by side. So compositing is the one pass that fills
+ * the encoders' frame, and the frame is handed on in order once its
+ * last tile is done, like from the conversion stage.
+ *
+ * Inputs that are late or gone:
+ *
+ * 	- the reading stage waits at most MOSAIC_WAIT_MS for all
+ * 	  inputs together. An input with no frame by then is late and
+ * 	  shows its previous frame again;
+ *
+ * 	- once a late input has frames queued again, it skips as many
+ * 	  as it was late for, so it gets back in step with the others;
+ *
+ * 	- an input that could not be opened, has not sent a frame yet
+ * 	  or has ended shows black. One that sends its first frame
+ * 	  later, like a FIFO whose source comes up late, joins then.
+ *
+ * The mosaic ends when every input has ended, or has not started
+ * within MOSAIC_START_MS of the mosaic. Inputs are read without
+ * blocking (polled, on POSIX systems), so that the reader threads
+ * stop with the mosaic even if a FIFO has no writer or a live source
+ * has stalled.
+ */
+
+#ifndef MOSAIC_H
+#define MOSAIC_H
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#define MOSAIC_POLL_MS 100	// how soon a reader thread sees stop
+
+typedef struct MosaicTile {
+	std::string path;
+	int src_w, src_h;		// of the input
+	int x, y, w, h;			// where it goes on the canvas
+} MosaicTile;
+
+typedef struct MosaicLayout {
+	int width;
+	int height;
+	AVRational fps;			// 25 unless the canvas line has one
+	std::vector<MosaicTile> tiles;
+} MosaicLayout;
+
+//nonzero if path names a .mosaic layout
+static int mosaic_is_mosaic(const char *path)
+{
+	size_t len = strlen(path);
+	return len > 7 && !strcmp(path + len - 7, ".mosaic");
+}
+
+//read the layout file at path into *layout; prints why it failed
+static bool mosaic_read_layout(const char *path, MosaicLayout *layout)
+{
+	FILE *fp = fopen(path, "r");
+	if (!fp) {
+		printf("Could not open %s\n", path);
+		return false;
+	}
+	char line[1024];
+	int number = 0;
+	bool ok = true;
+	layout->width = layout->height = 0;
+	layout->fps.num = 25;
+	layout->fps.den = 1;
+	layout->tiles.clear();
+	while (ok && fgets(line, sizeof(line), fp)) {
+		char name[1024];
+		number++;
+		if (line[0] == '#' || sscanf(line, "%1023s", name) != 1)
+			continue;
+		if (!strcmp(name, "canvas")) {
+			int num = 25, den = 1;
+			ok = sscanf(line, "canvas %dx%d %d/%d", &layout->width, &layout->height, &num, &den) >= 2 &&
+			     layout->width > 0 && layout->height > 0 && !((layout->width | layout->height) & 1) &&
+			     num > 0 && den > 0;
+			layout->fps.num = num;
+			layout->fps.den = den;
+			continue;
+		}
+		MosaicTile tile;
+		tile.path = name;
+		ok = sscanf(line, "%*s %dx%d %d,%d %dx%d", &tile.src_w, &tile.src_h, &tile.x, &tile.y, &tile.w, &tile.h) == 6 &&
+		     layout->width > 0 && tile.src_w > 0 && tile.src_h > 0 && tile.w > 0 && tile.h > 0 &&
+		     tile.x >= 0 && tile.y >= 0 && tile.x + tile.w <= layout->width && tile.y + tile.h <= layout->height &&
+		     !((tile.x | tile.y | tile.w | tile.h) & 1);
+		if (ok)
+			layout->tiles.push_back(tile);
+	}
+	fclose(fp);
+	if (!ok) {
+		printf("Bad line %d in %s: a canvas first, then inputs on it at even positions and sizes\n",
+		       number, path);
+		return false;
+	}
+	if (layout->tiles.empty()) {
+		printf("No inputs in %s\n", path);
+		return false;
+	}
+	return true;
+}
+
+class MosaicStage
+{
+public:
+	//receives the composited frames (and passed NULLs) in push order
+	typedef std::function<void(AVFrame *frame, int tag)> Deliver;
+
+private:
+	struct Feed : MosaicTile
+	{
+		int layer;			// drawn after the tiles of lower layers
+#ifdef _WIN32
+		FILE *fp;
+#else
+		int fd;
+#endif
+		FramePool frames;
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::deque<AVFrame*> ready;	// read, not shown yet
+		std::shared_ptr<AVFrame> shown;	// the current frame, until a new one comes
+		bool ended;
+		bool stop;
+		std::vector<SwsContext *> free_sws;
+		std::vector<SwsContext *> all_sws;
+		int shown_frames, late, dropped;
+		int behind;			// late repeats not made up for yet
+
+		Feed(const MosaicTile &tile)
+			: MosaicTile(tile), layer(0),
+#ifdef _WIN32
+			  fp(NULL),
+#else
+			  fd(-1),
+#endif
+			  frames(tile.src_w, tile.src_h, AV_PIX_FMT_YUV420P, 1),
+			  ended(false), stop(false), shown_frames(0), late(0), dropped(0), behind(0) {}
+	};
+
+	//one frame being composited
+	struct Composite
+	{
+		AVFrame *frame;
+		int tag;
+		long long seq;
+		int layer;
+		std::atomic<int> left;		// tiles of the layer still running
+		std::vector<std::shared_ptr<AVFrame> > sources;
+	};
+
+	struct Job
+	{
+		AVFrame *frame;
+		int      tag;
+	};
+
+	std::vector<std::unique_ptr<Feed> > d_feeds;
+	std::vector<std::vector<int> > d_layers;	// feeds per layer
+	int d_width;
+	int d_height;
+	bool d_covered;				// the tiles leave no canvas uncovered
+	int d_queue;
+	int d_wait_ms;
+	std::chrono::steady_clock::time_point d_start_by;	// inputs not started by then are given up
+	Deliver d_deliver;
+
+	std::mutex d_mutex;
+	std::map<long long, Job> d_done;	// finished, waiting for earlier frames
+	long long d_next_in;
+	long long d_next_out;
+
+#ifdef _WIN32
+	bool open_feed(Feed *feed) {
+		feed->fp = fopen(feed->path.c_str(), "rb");
+		return feed->fp != NULL;
+	}
+
+	//blocking: a stalled input holds its thread until it sends or ends
+	bool read_frame(Feed *feed, uint8_t *buf, int bytes) {
+		return fread(buf, 1, bytes, feed->fp) == (size_t)bytes;
+	}
+
+	void close_feed(Feed *feed) {
+		if (feed->fp)
+			fclose(feed->fp);
+	}
+#else
+	//a FIFO opens at once without O_NONBLOCK, even if it has no writer yet
+	bool open_feed(Feed *feed) {
+		feed->fd = open(feed->path.c_str(), O_RDONLY | O_NONBLOCK);
+		return feed->fd >= 0;
+	}
+
+	//read bytes into buf, false at the end of the input or once stopped
+	bool read_frame(Feed *feed, uint8_t *buf, int bytes) {
+		int got = 0;
+		while (got < bytes) {
+			{
+				std::unique_lock<std::mutex> lock(feed->mutex);
+				if (feed->stop)
+					return false;
+			}
+			struct pollfd pfd;
+			pfd.fd = feed->fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			int ready = poll(&pfd, 1, MOSAIC_POLL_MS);
+			if (ready < 0 && errno != EINTR)
+				return false;
+			if (ready <= 0)
+				continue;
+			ssize_t n = read(feed->fd, buf + got, bytes - got);
+			if (n < 0 && (errno == EAGAIN || errno == EINTR))
+				continue;
+			if (n <= 0)
+				return false;
+			got += (int)n;
+		}
+		return true;
+	}
+
+	void close_feed(Feed *feed) {
+		if (feed->fd >= 0)
+			close(feed->fd);
+	}
+#endif
+
+	void read_feed(Feed *feed) {
+		int bytes = avpicture_get_size(AV_PIX_FMT_YUV420P, feed->src_w, feed->src_h);
+		bool open = open_feed(feed);
+		if (!open)
+			printf("Could not open %s, shown black\n", feed->path.c_str());
+		while (open) {
+			{
+				std::unique_lock<std::mutex> lock(feed->mutex);
+				feed->changed.wait(lock, [=]{ return feed->stop || (int)feed->ready.size() < this->d_queue; });
+				if (feed->stop)
+					break;
+			}
+			AVFrame *frame = feed->frames.get();
+			if (!frame || !read_frame(feed, frame->data[0], bytes)) {
+				//a partial last frame is dropped
+				if (frame)
+					feed->frames.put(frame);
+				break;
+			}
+			std::unique_lock<std::mutex> lock(feed->mutex);
+			feed->ready.push_back(frame);
+			feed->changed.notify_all();
+		}
+		std::unique_lock<std::mutex> lock(feed->mutex);
+		feed->ended = true;
+		feed->changed.notify_all();
+	}
+
+	static void fill_black(AVFrame *frame, int x, int y, int w, int h) {
+		for (int p = 0; p < 3; p++) {
+			int s = p ? 1 : 0;
+			for (int row = y >> s; row < (y + h) >> s; row++)
+				memset(frame->data[p] + row * frame->linesize[p] + (x >> s), p ? 128 : 16, w >> s);
+		}
+	}
+
+	SwsContext *take_sws(Feed *feed) {
+		{
+			std::unique_lock<std::mutex> lock(feed->mutex);
+			if (!feed->free_sws.empty()) {
+				SwsContext *sws = feed->free_sws.back();
+				feed->free_sws.pop_back();
+				return sws;
+			}
+		}
+		SwsContext *sws = sws_getContext(feed->src_w, feed->src_h, AV_PIX_FMT_YUV420P,
+						 feed->w, feed->h, AV_PIX_FMT_YUV420P, SWS_BILINEAR, NULL, NULL, NULL);
+		if (sws) {
+			std::unique_lock<std::mutex> lock(feed->mutex);
+			feed->all_sws.push_back(sws);
+		}
+		return sws;
+	}
+
+	//draw src, NULL for black, into feed's tile of dst
+	void blit(Feed *feed, const AVFrame *src, AVFrame *dst) {
+		if (!src) {
+			fill_black(dst, feed->x, feed->y, feed->w, feed->h);
+			return;
+		}
+		uint8_t *out[4] = { NULL, NULL, NULL, NULL };
+		for (int p = 0; p < 3; p++) {
+			int s = p ? 1 : 0;
+			out[p] = dst->data[p] + (feed->y >> s) * dst->linesize[p] + (feed->x >> s);
+		}
+		if (feed->w == feed->src_w && feed->h == feed->src_h) {
+			for (int p = 0; p < 3; p++) {
+				int s = p ? 1 : 0;
+				av_image_copy_plane(out[p], dst->linesize[p], src->data[p], src->linesize[p],
+						    -((-feed->w) >> s), -((-feed->h) >> s));
+			}
+			return;
+		}
+		SwsContext *sws = take_sws(feed);
+		if (!sws) {
+			fill_black(dst, feed->x, feed->y, feed->w, feed->h);
+			return;
+		}
+		sws_scale(sws, src->data, src->linesize, 0, feed->src_h, out, dst->linesize);
+		std::unique_lock<std::mutex> lock(feed->mutex);
+		feed->free_sws.push_back(sws);
+	}
+
+	//run the tiles of job's current layer, the last one to finish starts the next layer
+	void run_layer(TaskPool &pool, std::shared_ptr<Composite> job) {
+		const std::vector<int> &tiles = d_layers[job->layer];
+		job->left = (int)tiles.size();
+		for (size_t t = 0; t < tiles.size(); t++) {
+			int f = tiles[t];
+			pool.submit([this, &pool, job, f]{
+				this->blit(this->d_feeds[f].get(), job->sources[f].get(), job->frame);
+				if (--job->left > 0)
+					return;
+				if (++job->layer < (int)this->d_layers.size()) {
+					this->run_layer(pool, job);
+					return;
+				}
+				job->sources.clear();	// back to the feeds' pools, unless still shown
+				this->finish(job->seq, job->frame, job->tag);
+			});
+		}
+	}
+
+	//frame seq is done, hand on everything that is due
+	void finish(long long seq, AVFrame *frame, int tag) {
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		Job job = { frame, tag };
+		d_done[seq] = job;
+		//deliver under the lock, or two finishers could overtake each other
+		while (!d_done.empty() && d_done.begin()->first == d_next_out) {
+			d_deliver(d_done.begin()->second.frame, d_done.begin()->second.tag);
+			d_done.erase(d_done.begin());
+			d_next_out++;
+		}
+	}
+
+	static bool overlap(const Feed &a, const Feed &b) {
+		return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+	}
+
+public:
+	/*
+	 * Start reading the inputs of layout, up to queue frames ahead, and
+	 * composite at most wait_ms behind them. An input that cannot be
+	 * opened shows black, one that has sent nothing within start_ms no
+	 * longer keeps the mosaic going.
+	 */
+	MosaicStage(const MosaicLayout &layout, int queue, int wait_ms, int start_ms, Deliver deliver)
+		: d_width(layout.width), d_height(layout.height), d_covered(false), d_queue(queue < 1 ? 1 : queue),
+		  d_wait_ms(wait_ms), d_start_by(std::chrono::steady_clock::now() + std::chrono::milliseconds(start_ms)),
+		  d_deliver(deliver), d_next_in(0), d_next_out(0) {
+		for (size_t f = 0; f < layout.tiles.size(); f++)
+			d_feeds.push_back(std::unique_ptr<Feed>(new Feed(layout.tiles[f])));
+		//a tile drawn over an earlier one has to wait for it
+		for (size_t f = 0; f < d_feeds.size(); f++) {
+			for (size_t e = 0; e < f; e++)
+				if (overlap(*d_feeds[e], *d_feeds[f]) && d_feeds[f]->layer <= d_feeds[e]->layer)
+					d_feeds[f]->layer = d_feeds[e]->layer + 1;
+			if (d_feeds[f]->layer >= (int)d_layers.size())
+				d_layers.resize(d_feeds[f]->layer + 1);
+			d_layers[d_feeds[f]->layer].push_back((int)f);
+		}
+		//does the canvas show through anywhere? checked on the chroma grid
+		std::vector<char> covered((d_width / 2) * (d_height / 2), 0);
+		for (size_t f = 0; f < d_feeds.size(); f++) {
+			const Feed &feed = *d_feeds[f];
+			for (int y = feed.y / 2; y < (feed.y + feed.h) / 2; y++)
+				memset(&covered[y * (d_width / 2) + feed.x / 2], 1, feed.w / 2);
+		}
+		d_covered = std::find(covered.begin(), covered.end(), 0) == covered.end();
+		for (size_t f = 0; f < d_feeds.size(); f++)
+			d_feeds[f]->thread = std::thread(&MosaicStage::read_feed, this, d_feeds[f].get());
+	}
+
+	~MosaicStage() {
+		for (size_t f = 0; f < d_feeds.size(); f++) {
+			Feed *feed = d_feeds[f].get();
+			{
+				std::unique_lock<std::mutex> lock(feed->mutex);
+				feed->stop = true;
+				feed->changed.notify_all();
+			}
+			if (feed->thread.joinable())
+				feed->thread.join();
+			close_feed(feed);
+			feed->shown.reset();
+			for (size_t k = 0; k < feed->ready.size(); k++)
+				feed->frames.put(feed->ready[k]);
+			for (size_t k = 0; k < feed->all_sws.size(); k++)
+				sws_freeContext(feed->all_sws[k]);
+		}
+	}
+
+	int inputs() const { return (int)d_feeds.size(); }
+
+	/*
+	 * Take the next frame of every input and composite them into dst
+	 * on pool, then deliver dst with tag. Returns false, and does not
+	 * take dst, once every input has ended or not started in time.
+	 * Call from one thread only.
+	 */
+	bool compose(TaskPool &pool, AVFrame *dst, int tag) {
+		std::shared_ptr<Composite> job(new Composite);
+		job->sources.resize(d_feeds.size());
+		std::chrono::steady_clock::time_point deadline =
+			std::chrono::steady_clock::now() + std::chrono::milliseconds(d_wait_ms);
+		bool starting = std::chrono::steady_clock::now() < d_start_by;
+		bool live = false;
+		for (size_t f = 0; f < d_feeds.size(); f++) {
+			Feed *feed = d_feeds[f].get();
+			std::unique_lock<std::mutex> lock(feed->mutex);
+			feed->changed.wait_until(lock, deadline, [=]{ return !feed->ready.empty() || feed->ended; });
+			//skip what the input was late with, keeping one frame to show
+			while (feed->behind > 0 && feed->ready.size() > 1) {
+				feed->frames.put(feed->ready.front());
+				feed->ready.pop_front();
+				feed->dropped++;
+				feed->behind--;
+			}
+			if (!feed->ready.empty()) {
+				FramePool *frames = &feed->frames;
+				feed->shown.reset(feed->ready.front(), [frames](AVFrame *frame) { frames->put(frame); });
+				feed->ready.pop_front();
+				feed->shown_frames++;
+				feed->changed.notify_all();
+				live = true;
+			} else if (feed->ended) {
+				feed->shown.reset();	// gone, black from now on
+			} else if (feed->shown_frames) {
+				feed->late++;
+				feed->behind++;
+				live = true;
+			} else {
+				//not started: black, and waited for only while the mosaic starts
+				live = live || starting;
+			}
+			job->sources[f] = feed->shown;
+		}
+		if (!live)
+			return false;
+		if (!d_covered)
+			fill_black(dst, 0, 0, d_width, d_height);
+		job->frame = dst;
+		job->tag = tag;
+		job->layer = 0;
+		{
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			job->seq = d_next_in++;
+		}
+		run_layer(pool, job);
+		return true;
+	}
+
+	//deliver frame (which may be NULL) unchanged, behind every frame composed before
+	void pass(AVFrame *frame, int tag) {
+		long long seq;
+		{
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			seq = d_next_in++;
+		}
+		finish(seq, frame, tag);
+	}
+
+	void report() {
+		for (size_t f = 0; f < d_feeds.size(); f++) {
+			const Feed &feed = *d_feeds[f];
+			printf("Mosaic: %s %d frames shown, %d late, %d dropped\n", feed.path.c_str(),
+			       feed.shown_frames, feed.late, feed.dropped);
+		}
+	}
+};
+
+#endif
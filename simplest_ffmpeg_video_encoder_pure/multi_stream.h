@@ -0,0 +1,446 @@
+/**
+ * Multi-stream mode for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers and task_pool.h. POSIX only.
+ *
+ * Encodes every stream listed in STREAM_LIST at the same time, one
+ * stream per line:
+ *
+ * 	<input.yuv> <width>x<height> <output> [bitrate]
+ *
+ * Lines starting with '#' are ignored. Inputs are raw YUV420P files,
+ * or FIFOs fed by a live source.
+ *
+ * A stream is not a thread but a resumable job: its read/encode/write
+ * loop is a small state machine (EncodeStream::state) that the task
+ * pool resumes wherever it left off. A job gives its thread back
+ *
+ * 	- after STREAM_SLICE frames, by requeueing itself behind the
+ * 	  other jobs of that thread (TaskPool::defer), and
+ *
+ * 	- when its input has no data yet, by handing itself to the
+ * 	  IoWaiter, which polls all parked inputs on one thread and
+ * 	  puts a job back on the pool once its input is readable.
+ *
+ * So the thread count follows the cores (POOL_THREADS), not the
+ * streams, and a stream costs its codec state plus one frame buffer
+ * and an EncodeStream. Every codec context runs single-threaded, the
+ * parallelism comes from running many streams at once. The streams
+ * are opened one after another before any job starts, as
+ * avcodec_open2() is not thread safe.
+ */
+
+#ifndef MULTI_STREAM_H
+#define MULTI_STREAM_H
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#ifndef _WIN32
+
+/*
+ * Parks jobs whose input would block. One thread polls the inputs of
+ * all parked jobs and submits a job to the pool when its input becomes
+ * readable (or hangs up, so the job sees the EOF).
+ */
+class IoWaiter
+{
+private:
+	TaskPool &d_pool;
+	std::mutex d_mutex;
+	std::vector<std::pair<int, std::function<void()> > > d_waiting;
+	std::thread d_thread;
+	int d_wake[2];
+	bool d_stop;
+
+	void run() {
+		std::vector<struct pollfd> fds;
+		while (true) {
+			fds.clear();
+			struct pollfd wake = { d_wake[0], POLLIN, 0 };
+			fds.push_back(wake);
+			{
+				std::unique_lock<std::mutex> lock(this->d_mutex);
+				if (d_stop)
+					return;
+				for (size_t k = 0; k < d_waiting.size(); k++) {
+					struct pollfd pfd = { d_waiting[k].first, POLLIN, 0 };
+					fds.push_back(pfd);
+				}
+			}
+			if (poll(&fds[0], fds.size(), -1) < 0)
+				continue;
+			if (fds[0].revents) {
+				char buf[64];
+				while (read(d_wake[0], buf, sizeof(buf)) > 0)
+					;
+			}
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			for (size_t k = 1; k < fds.size(); k++) {
+				if (!fds[k].revents)
+					continue;
+				for (size_t w = 0; w < d_waiting.size(); w++) {
+					if (d_waiting[w].first == fds[k].fd) {
+						d_pool.submit(d_waiting[w].second);
+						d_waiting.erase(d_waiting.begin() + w);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	void wake() {
+		char c = 0;
+		if (write(d_wake[1], &c, 1) < 0) {
+			//the pipe is full, the poller is woken up anyway
+		}
+	}
+
+public:
+	IoWaiter(TaskPool &pool): d_pool(pool), d_stop(false) {
+		if (pipe(d_wake) < 0) {
+			d_wake[0] = d_wake[1] = -1;
+			return;
+		}
+		fcntl(d_wake[0], F_SETFL, O_NONBLOCK);
+		fcntl(d_wake[1], F_SETFL, O_NONBLOCK);
+		d_thread = std::thread(&IoWaiter::run, this);
+	}
+
+	~IoWaiter() {
+		{
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			d_stop = true;
+		}
+		if (d_thread.joinable()) {
+			wake();
+			d_thread.join();
+		}
+		if (d_wake[0] >= 0) {
+			close(d_wake[0]);
+			close(d_wake[1]);
+		}
+	}
+
+	bool ok() const { return d_wake[0] >= 0; }
+
+	//run fn on the pool once fd is readable
+	void wait_readable(int fd, std::function<void()> fn) {
+		{
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			d_waiting.push_back(std::make_pair(fd, fn));
+		}
+		wake();
+	}
+};
+
+struct EncodeStream
+{
+	enum State { OPEN, READ, ENCODE, FLUSH, DONE };
+
+	std::string     in_path;
+	std::string     out_path;
+	int             width;
+	int             height;
+	int             bit_rate;
+	State           state;
+	bool            failed;
+	int             fd_in;
+	FILE           *fp_out;
+	AVCodecContext *ctx;
+	AVFrame        *frame;
+	size_t          frame_size;
+	size_t          filled;	// bytes of the current frame read so far
+	int64_t         frames;
+	int64_t         bytes;
+};
+
+class MultiStream
+{
+private:
+	TaskPool   &d_pool;
+	IoWaiter    d_waiter;
+	AVCodec    *d_codec;
+	Completion  d_finished;
+	std::atomic<int> d_running;
+	std::vector<std::unique_ptr<EncodeStream> > d_streams;
+
+	bool open_stream(EncodeStream *s) {
+		s->fd_in = open(s->in_path.c_str(), O_RDONLY | O_NONBLOCK);
+		if (s->fd_in < 0) {
+			printf("Could not open %s\n", s->in_path.c_str());
+			return false;
+		}
+		s->fp_out = fopen(s->out_path.c_str(), "wb");
+		if (!s->fp_out) {
+			printf("Could not open %s\n", s->out_path.c_str());
+			return false;
+		}
+		s->ctx = avcodec_alloc_context3(d_codec);
+		s->frame = av_frame_alloc();
+		if (!s->ctx || !s->frame) {
+			printf("Could not allocate codec context for %s\n", s->in_path.c_str());
+			return false;
+		}
+		s->ctx->bit_rate = s->bit_rate;
+		s->ctx->width = s->width;
+		s->ctx->height = s->height;
+		s->ctx->time_base.num = 1;
+		s->ctx->time_base.den = 25;
+		s->ctx->gop_size = 10;
+		s->ctx->max_b_frames = 1;
+		s->ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+		s->ctx->thread_count = 1;	// no codec threads per stream
+		if (d_codec->id == AV_CODEC_ID_H264)
+			av_opt_set(s->ctx->priv_data, "preset", "slow", 0);
+		if (avcodec_open2(s->ctx, d_codec, NULL) < 0) {
+			printf("Could not open codec for %s\n", s->in_path.c_str());
+			return false;
+		}
+		s->frame->format = s->ctx->pix_fmt;
+		s->frame->width = s->width;
+		s->frame->height = s->height;
+		//packed planes, so a frame is read with plain sequential reads
+		int size = av_image_alloc(s->frame->data, s->frame->linesize, s->width, s->height,
+					  s->ctx->pix_fmt, 1);
+		if (size < 0) {
+			printf("Could not allocate raw picture buffer for %s\n", s->in_path.c_str());
+			return false;
+		}
+		s->frame_size = size;
+		return true;
+	}
+
+	//encode frame, NULL to flush; false once nothing more comes out
+	bool encode(EncodeStream *s, AVFrame *frame) {
+		AVPacket pkt;
+		int got_output = 0;
+		av_init_packet(&pkt);
+		pkt.data = NULL;
+		pkt.size = 0;
+		if (avcodec_encode_video2(s->ctx, &pkt, frame, &got_output) < 0) {
+			printf("Error encoding frame of %s\n", s->in_path.c_str());
+			s->failed = true;
+			return false;
+		}
+		if (got_output) {
+			fwrite(pkt.data, 1, pkt.size, s->fp_out);
+			s->bytes += pkt.size;
+			av_free_packet(&pkt);
+		}
+		return got_output != 0;
+	}
+
+	void finish(EncodeStream *s) {
+		if (s->failed)
+			printf("Stream %s failed after %lld frames\n", s->in_path.c_str(), (long long)s->frames);
+		else
+			printf("Stream %s: %lld frames, %lld bytes\n", s->in_path.c_str(),
+			       (long long)s->frames, (long long)s->bytes);
+		if (s->fd_in >= 0)
+			close(s->fd_in);
+		if (s->fp_out)
+			fclose(s->fp_out);
+		if (s->frame)
+			av_freep(&s->frame->data[0]);
+		av_frame_free(&s->frame);
+		avcodec_free_context(&s->ctx);
+		s->fd_in = -1;
+		s->fp_out = NULL;
+		if (--d_running == 0)
+			d_finished.signal();
+	}
+
+	/*
+	 * Run a stream from wherever it stopped until it has encoded
+	 * STREAM_SLICE frames, has to wait for input, or is done.
+	 */
+	void resume(EncodeStream *s) {
+		int slice = STREAM_SLICE;
+		while (true) {
+			switch (s->state) {
+			case EncodeStream::OPEN: {
+				//opened by run() already
+				s->state = EncodeStream::READ;
+				//a FIFO reads EOF until its writer shows up, wait for data first
+				struct stat st;
+				if (fstat(s->fd_in, &st) == 0 && S_ISFIFO(st.st_mode)) {
+					d_waiter.wait_readable(s->fd_in, [this, s]{ this->resume(s); });
+					return;
+				}
+				break;
+			}
+			case EncodeStream::READ: {
+				ssize_t n = read(s->fd_in, s->frame->data[0] + s->filled, s->frame_size - s->filled);
+				if (n < 0 && errno == EINTR)
+					break;
+				if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+					d_waiter.wait_readable(s->fd_in, [this, s]{ this->resume(s); });
+					return;
+				}
+				if (n < 0) {
+					printf("Could not read %s\n", s->in_path.c_str());
+					s->failed = true;
+				}
+				if (n <= 0) {
+					//a partial last frame is dropped
+					s->state = EncodeStream::FLUSH;
+					break;
+				}
+				s->filled += n;
+				if (s->filled == s->frame_size)
+					s->state = EncodeStream::ENCODE;
+				break;
+			}
+			case EncodeStream::ENCODE:
+				s->frame->pts = s->frames;
+				if (!encode(s, s->frame) && s->failed) {
+					s->state = EncodeStream::DONE;
+					break;
+				}
+				s->frames++;
+				s->filled = 0;
+				s->state = EncodeStream::READ;
+				if (--slice == 0) {
+					d_pool.defer([this, s]{ this->resume(s); });
+					return;
+				}
+				break;
+			case EncodeStream::FLUSH:
+				if (!encode(s, NULL))
+					s->state = EncodeStream::DONE;
+				break;
+			case EncodeStream::DONE:
+				finish(s);
+				return;
+			}
+		}
+	}
+
+public:
+	MultiStream(TaskPool &pool, AVCodec *codec)
+		: d_pool(pool), d_waiter(pool), d_codec(codec), d_running(0) {}
+
+	//parse the stream list, false if it cannot be read
+	bool load(const char *list) {
+		FILE *fp = fopen(list, "r");
+		if (!fp) {
+			printf("Could not open %s\n", list);
+			return false;
+		}
+		char line[1024];
+		char in[512], out[512];
+		int w, h, rate;
+		while (fgets(line, sizeof(line), fp)) {
+			if (line[0] == '#')
+				continue;
+			rate = 400000;
+			int n = sscanf(line, "%511s %dx%d %511s %d", in, &w, &h, out, &rate);
+			if (n <= 0)
+				continue;
+			if (n < 4 || w <= 0 || h <= 0) {
+				printf("Bad stream line: %s", line);
+				continue;
+			}
+			std::unique_ptr<EncodeStream> s(new EncodeStream);
+			s->in_path = in;
+			s->out_path = out;
+			s->width = w;
+			s->height = h;
+			s->bit_rate = rate;
+			s->state = EncodeStream::OPEN;
+			s->failed = false;
+			s->fd_in = -1;
+			s->fp_out = NULL;
+			s->ctx = NULL;
+			s->frame = NULL;
+			s->frame_size = 0;
+			s->filled = 0;
+			s->frames = 0;
+			s->bytes = 0;
+			d_streams.push_back(std::move(s));
+		}
+		fclose(fp);
+		return true;
+	}
+
+	int run() {
+		if (d_streams.empty()) {
+			printf("No streams to encode\n");
+			return -1;
+		}
+		if (!d_waiter.ok()) {
+			printf("Could not create the input poller\n");
+			return -1;
+		}
+		printf("Multi-stream: %d streams on %d threads, %d bytes of job state per stream\n",
+		       (int)d_streams.size(), d_pool.size(), (int)sizeof(EncodeStream));
+		d_running = (int)d_streams.size();
+		//a job that failed to open only cleans up
+		for (size_t k = 0; k < d_streams.size(); k++) {
+			EncodeStream *s = d_streams[k].get();
+			if (!open_stream(s)) {
+				s->failed = true;
+				s->state = EncodeStream::DONE;
+			}
+		}
+		for (size_t k = 0; k < d_streams.size(); k++) {
+			EncodeStream *s = d_streams[k].get();
+			d_pool.submit([this, s]{ this->resume(s); });
+		}
+		d_finished.wait();
+		d_pool.wait_idle();
+
+		int failed = 0;
+		for (size_t k = 0; k < d_streams.size(); k++)
+			failed += d_streams[k]->failed;
+		if (failed) {
+			printf("%d of %d streams failed\n", failed, (int)d_streams.size());
+			return -1;
+		}
+		return 0;
+	}
+};
+
+#endif
+
+/*
+ * Encode all streams listed in the file list with codec_id.
+ */
+static int run_multi_stream(const char *list, AVCodecID codec_id)
+{
+#ifdef _WIN32
+	printf("Multi-stream mode needs a POSIX system\n");
+	return -1;
+#else
+	AVCodec *codec = avcodec_find_encoder(codec_id);
+	if (!codec) {
+		printf("Codec not found\n");
+		return -1;
+	}
+	TaskPool pool(POOL_THREADS);
+	MultiStream streams(pool, codec);
+	if (!streams.load(list))
+		return -1;
+	return streams.run();
+#endif
+}
+
+#endif
@@ -0,0 +1,341 @@
+/**
+ * Packed raw input for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers, task_pool.h and y4m_reader.h. Needs libzstd 1.3 or
+ * later.
+ *
+ * Raw video compresses well losslessly, and on shared storage reading
+ * .yuv files is often what holds the encoders back. A .yuvz file keeps
+ * every frame as a zstd frame of its own, so frames decompress
+ * independently of each other:
+ *
+ * 	header	"YUVZ", version, width, height, frame rate and the
+ * 		pixel format name, 64 bytes, integers little-endian
+ * 	frames	one zstd frame per frame, the planes packed as in .yuv
+ * 	index	64-bit offsets of every frame and of the end of the last
+ * 	footer	32-bit frame count, "ZIDX"
+ *
+ * The reading stage only reads the compressed bytes, with the sizes
+ * from the index. Each frame is then decompressed by a task on the
+ * pool, so several frames decompress at once, straight into a pooled
+ * frame: in one call if the frame's planes lie back to back, otherwise
+ * row by row with the streaming decoder, each row its own output, so
+ * the padding needs no staging copy either way. Frames are handed on
+ * in read order, like from the conversion stage.
+ *
+ * "--pack" writes the input, raw or y4m, as .yuvz to the output file.
+ */
+
+#ifndef PACKED_INPUT_H
+#define PACKED_INPUT_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <zstd.h>
+
+#define PACKED_HEADER_SIZE 64
+#define PACKED_VERSION     1
+
+typedef struct PackedInfo {
+	int width;
+	int height;
+	AVRational fps;
+	enum AVPixelFormat pix_fmt;
+	int frames;
+	long long data_offset;		// where the first frame starts
+} PackedInfo;
+
+//nonzero if path names a .yuvz file
+static int packed_is_packed(const char *path)
+{
+	size_t len = strlen(path);
+	return len > 5 && (!strcmp(path + len - 5, ".yuvz") || !strcmp(path + len - 5, ".YUVZ"));
+}
+
+/*
+ * Read the header and the index of the .yuvz file fp, which must be
+ * seekable, and leave fp at the first frame. offsets gets frames + 1
+ * entries. Returns 0 on success, -1 if it is no usable .yuvz file.
+ */
+static int packed_read_header(FILE *fp, PackedInfo *info, std::vector<long long> *offsets)
+{
+	uint8_t head[PACKED_HEADER_SIZE], foot[8];
+	char name[33];
+	if (fread(head, 1, sizeof(head), fp) != sizeof(head) || memcmp(head, "YUVZ", 4) ||
+	    AV_RL32(head + 4) != PACKED_VERSION)
+		return -1;
+	info->width = AV_RL32(head + 8);
+	info->height = AV_RL32(head + 12);
+	info->fps.num = AV_RL32(head + 16);
+	info->fps.den = AV_RL32(head + 20);
+	memcpy(name, head + 24, 32);
+	name[32] = 0;
+	info->pix_fmt = av_get_pix_fmt(name);
+	info->data_offset = PACKED_HEADER_SIZE;
+	if (info->width <= 0 || info->height <= 0 || info->fps.num <= 0 || info->fps.den <= 0 ||
+	    info->pix_fmt == AV_PIX_FMT_NONE)
+		return -1;
+
+	if (fseek(fp, -8, SEEK_END) < 0 || fread(foot, 1, 8, fp) != 8 || memcmp(foot + 4, "ZIDX", 4))
+		return -1;
+	info->frames = AV_RL32(foot);
+	std::vector<uint8_t> index((size_t)(info->frames + 1) * 8);
+	if (fseek(fp, -8 - (long)index.size(), SEEK_END) < 0 ||
+	    fread(&index[0], 1, index.size(), fp) != index.size())
+		return -1;
+	offsets->resize(info->frames + 1);
+	for (int k = 0; k <= info->frames; k++) {
+		(*offsets)[k] = (long long)AV_RL64(&index[k * 8]);
+		if ((*offsets)[k] < (k ? (*offsets)[k - 1] : PACKED_HEADER_SIZE))
+			return -1;
+	}
+	return fseek(fp, PACKED_HEADER_SIZE, SEEK_SET) < 0 ? -1 : 0;
+}
+
+/*
+ * --pack: compress the frames of in, raw frames of fmt or y4m frames
+ * when y4m is set, into out at zstd level. Returns 0 or -1.
+ */
+static int packed_write(FILE *in, const Y4MInfo *y4m, FILE *out, int width, int height,
+			AVPixelFormat fmt, AVRational fps, int level)
+{
+	size_t frame_size = avpicture_get_size(fmt, width, height);
+	std::vector<uint8_t> raw(frame_size), packed(ZSTD_compressBound(frame_size));
+	std::vector<long long> offsets(1, PACKED_HEADER_SIZE);
+	uint8_t head[PACKED_HEADER_SIZE];
+	memset(head, 0, sizeof(head));
+	memcpy(head, "YUVZ", 4);
+	AV_WL32(head + 4, PACKED_VERSION);
+	AV_WL32(head + 8, width);
+	AV_WL32(head + 12, height);
+	AV_WL32(head + 16, fps.num);
+	AV_WL32(head + 20, fps.den);
+	strncpy((char *)head + 24, av_get_pix_fmt_name(fmt), 32);
+	ZSTD_CCtx *cctx = ZSTD_createCCtx();
+	if (!cctx || fwrite(head, 1, sizeof(head), out) != sizeof(head)) {
+		printf("Could not write the packed header\n");
+		ZSTD_freeCCtx(cctx);
+		return -1;
+	}
+	int ret = 0;
+	while ((!y4m || y4m_read_frame_header(in) == 0) && fread(&raw[0], 1, frame_size, in) == frame_size) {
+		size_t size = ZSTD_compressCCtx(cctx, &packed[0], packed.size(), &raw[0], frame_size, level);
+		if (ZSTD_isError(size)) {
+			printf("Could not compress frame %d: %s\n", (int)offsets.size() - 1, ZSTD_getErrorName(size));
+			ret = -1;
+			break;
+		}
+		if (fwrite(&packed[0], 1, size, out) != size) {
+			printf("Could not write frame %d\n", (int)offsets.size() - 1);
+			ret = -1;
+			break;
+		}
+		offsets.push_back(offsets.back() + (long long)size);
+	}
+	ZSTD_freeCCtx(cctx);
+	if (ret < 0)
+		return ret;
+
+	int frames = (int)offsets.size() - 1;
+	std::vector<uint8_t> index(offsets.size() * 8 + 8);
+	for (size_t k = 0; k < offsets.size(); k++)
+		AV_WL64(&index[k * 8], offsets[k]);
+	AV_WL32(&index[offsets.size() * 8], frames);
+	memcpy(&index[offsets.size() * 8 + 4], "ZIDX", 4);
+	if (fwrite(&index[0], 1, index.size(), out) != index.size()) {
+		printf("Could not write the packed index\n");
+		return -1;
+	}
+	printf("Packed %d frames: %.2fx smaller than the raw frames\n", frames,
+	       frames ? (double)frame_size * frames / (offsets.back() - PACKED_HEADER_SIZE) : 0.0);
+	return 0;
+}
+
+class UnpackStage
+{
+public:
+	//receives the unpacked frames (and passed NULLs) in read order
+	typedef std::function<void(AVFrame *frame, int tag)> Deliver;
+
+private:
+	struct Job
+	{
+		std::vector<uint8_t> packed;
+		ZSTD_DStream        *stream;
+	};
+
+	struct Done
+	{
+		AVFrame *frame;
+		int      tag;
+	};
+
+	FILE                  *d_fp;
+	PackedInfo             d_info;
+	std::vector<long long> d_offsets;
+	int                    d_row_bytes[4];
+	int                    d_rows[4];
+	int                    d_next_frame;
+	Deliver                d_deliver;
+	std::atomic<bool>      d_failed;
+
+	std::mutex             d_mutex;
+	std::vector<Job *>     d_free_jobs;
+	std::vector<Job *>     d_all_jobs;
+	std::map<long long, Done> d_done;	// finished, waiting for earlier frames
+	long long              d_next_in;
+	long long              d_next_out;
+
+	Job *take_job() {
+		{
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			if (!d_free_jobs.empty()) {
+				Job *job = d_free_jobs.back();
+				d_free_jobs.pop_back();
+				return job;
+			}
+		}
+		Job *job = new Job;
+		job->stream = ZSTD_createDStream();
+		if (!job->stream) {
+			delete job;
+			return NULL;
+		}
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		d_all_jobs.push_back(job);
+		return job;
+	}
+
+	//true if the planes of frame lie back to back, rows unpadded, as in the packed frame
+	bool contiguous(const AVFrame *frame) const {
+		const uint8_t *end = frame->data[0];
+		for (int p = 0; p < 4 && d_rows[p]; p++) {
+			if (frame->data[p] != end || frame->linesize[p] != d_row_bytes[p])
+				return false;
+			end += (size_t)d_row_bytes[p] * d_rows[p];
+		}
+		return true;
+	}
+
+	bool unpack(Job *job, AVFrame *dst) {
+		const void *src = &job->packed[0];
+		size_t size = job->packed.size();
+		if (contiguous(dst)) {
+			size_t frame_size = avpicture_get_size(d_info.pix_fmt, d_info.width, d_info.height);
+			return ZSTD_decompressDCtx(job->stream, dst->data[0], frame_size, src, size) == frame_size;
+		}
+		ZSTD_initDStream(job->stream);
+		ZSTD_inBuffer in = { src, size, 0 };
+		for (int p = 0; p < 4 && d_rows[p]; p++) {
+			for (int y = 0; y < d_rows[p]; y++) {
+				ZSTD_outBuffer out = { dst->data[p] + y * dst->linesize[p], (size_t)d_row_bytes[p], 0 };
+				while (out.pos < out.size) {
+					size_t in_pos = in.pos, out_pos = out.pos;
+					if (ZSTD_isError(ZSTD_decompressStream(job->stream, &out, &in)) ||
+					    (in.pos == in_pos && out.pos == out_pos))
+						return false;	// corrupt, or the frame ended early
+				}
+			}
+		}
+		return true;
+	}
+
+	//frame seq is done, hand on everything that is due
+	void finish(long long seq, AVFrame *frame, int tag) {
+		std::unique_lock<std::mutex> lock(this->d_mutex);
+		Done done = { frame, tag };
+		d_done[seq] = done;
+		while (!d_done.empty() && d_done.begin()->first == d_next_out) {
+			d_deliver(d_done.begin()->second.frame, d_done.begin()->second.tag);
+			d_done.erase(d_done.begin());
+			d_next_out++;
+		}
+	}
+
+public:
+	//fp and info as left by packed_read_header()
+	UnpackStage(FILE *fp, const PackedInfo &info, const std::vector<long long> &offsets, Deliver deliver)
+		: d_fp(fp), d_info(info), d_offsets(offsets), d_next_frame(0), d_deliver(deliver), d_failed(false),
+		  d_next_in(0), d_next_out(0) {
+		int linesize[4];
+		uint8_t *data[4];
+		av_image_fill_linesizes(linesize, info.pix_fmt, info.width);
+		av_image_fill_pointers(data, info.pix_fmt, info.height, NULL, linesize);
+		const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(info.pix_fmt);
+		for (int p = 0; p < 4; p++) {
+			d_row_bytes[p] = linesize[p];
+			d_rows[p] = !linesize[p] ? 0 : p == 1 || p == 2 ?
+				    FF_CEIL_RSHIFT(info.height, desc->log2_chroma_h) : info.height;
+		}
+	}
+
+	~UnpackStage() {
+		for (size_t k = 0; k < d_all_jobs.size(); k++) {
+			ZSTD_freeDStream(d_all_jobs[k]->stream);
+			delete d_all_jobs[k];
+		}
+	}
+
+	//true once a frame failed to decompress
+	bool failed() const { return d_failed; }
+
+	/*
+	 * Read the next packed frame and decompress it into dst on pool,
+	 * then deliver dst with tag. Call from one thread only. Returns
+	 * false, and takes no frame, at the end of the input or when it
+	 * cannot be read.
+	 */
+	bool read(TaskPool &pool, AVFrame *dst, int tag) {
+		if (d_next_frame >= d_info.frames)
+			return false;
+		Job *job = take_job();
+		if (!job) {
+			printf("Could not allocate a zstd decoder\n");
+			d_failed = true;
+			return false;
+		}
+		int frame = d_next_frame;
+		job->packed.resize((size_t)(d_offsets[frame + 1] - d_offsets[frame]));
+		if (fread(&job->packed[0], 1, job->packed.size(), d_fp) != job->packed.size()) {
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			d_free_jobs.push_back(job);
+			return false;
+		}
+		d_next_frame++;
+		long long seq;
+		{
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			seq = d_next_in++;
+		}
+		pool.submit([this, job, dst, tag, seq, frame]{
+			if (!this->unpack(job, dst)) {
+				printf("Packed frame %d is corrupt\n", frame);
+				this->d_failed = true;
+			}
+			{
+				std::unique_lock<std::mutex> lock(this->d_mutex);
+				this->d_free_jobs.push_back(job);
+			}
+			this->finish(seq, dst, tag);
+		});
+		return true;
+	}
+
+	//deliver frame (which may be NULL) unchanged, behind every frame read before
+	void pass(AVFrame *frame, int tag) {
+		long long seq;
+		{
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			seq = d_next_in++;
+		}
+		finish(seq, frame, tag);
+	}
+};
+
+#endif
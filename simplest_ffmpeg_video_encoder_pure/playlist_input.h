@@ -0,0 +1,430 @@
+/**
+ * Playlist input for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers, task_pool.h and y4m_reader.h.
+ *
+ * A .playlist input (or any input with --playlist) is a text file
+ * naming clips, which are encoded one after another as one input:
+ *
+ * 	# opening
+ * 	intro.y4m
+ * 	cam1.yuv frames 100 400
+ * 	cam2.yuv bytes 4096
+ *
+ * 	frames A [B]	frames A up to, not including, B of the clip
+ * 	bytes A [B]	the whole frames in bytes A to B of a raw clip,
+ * 			e.g. to skip a capture header
+ *
+ * Without B a range runs to the end of the clip. Relative paths are
+ * relative to the playlist. Raw clips have the size and pixel format
+ * of --size and --pix-fmt, or of the first clip if that is a y4m one,
+ * which also sets the frame rate; every y4m clip must match them.
+ *
+ * A .edl input (or any input with --edl) is an edit decision list:
+ * frame ranges of a source, in any order and repeated at will, cut
+ * into one encode, e.g. highlights of a long capture:
+ *
+ * 	source match.yuv
+ * 	108000 108750
+ * 	20250 20500
+ * 	108000 108250
+ *
+ * 	source PATH	the clip the ranges below it are cut from
+ * 	A B		frames A up to, not including, B
+ *
+ * Every range becomes an entry of its own, as if the playlist named
+ * the source with "frames A B". A frame's offset follows from its
+ * number, the fixed frame size and, for y4m, the header size, so each
+ * range is reached with one seek, however far into the source.
+ *
+ * The encoders see one continuous input in one session: timestamps
+ * run on across the clips and rate control carries over, where
+ * encoding each clip on its own and joining the bitstreams restarts
+ * the encoder at every boundary. While a clip is read, a task on the
+ * pool opens the next one, parses its header, seeks to its range and
+ * asks the OS to read the first PLAYLIST_PREFETCH frames of it in the
+ * background, so the switch waits neither for the open nor for a cold
+ * first read.
+ *
+ * A clip with a range is read with the OS readahead off
+ * (POSIX_FADV_RANDOM), which would otherwise run on past the end of
+ * the range; instead the reader asks for the next PLAYLIST_PREFETCH
+ * frames of the range at a time, never beyond its end. So only the
+ * bytes that get encoded are read from disk, which matters when a
+ * few minutes are cut from hours of raw video.
+ */
+
+#ifndef PLAYLIST_INPUT_H
+#define PLAYLIST_INPUT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#ifdef _WIN32
+#define playlist_seek _fseeki64
+#define playlist_tell _ftelli64
+#else
+#include <fcntl.h>
+#define playlist_seek fseeko
+#define playlist_tell ftello
+#endif
+
+//nonzero if path names a .playlist file
+static int playlist_is_playlist(const char *path)
+{
+	size_t len = strlen(path);
+	return len > 9 && !strcmp(path + len - 9, ".playlist");
+}
+
+//nonzero if path names a .edl file
+static int playlist_is_edl(const char *path)
+{
+	size_t len = strlen(path);
+	return len > 4 && (!strcmp(path + len - 4, ".edl") || !strcmp(path + len - 4, ".EDL"));
+}
+
+typedef struct PlaylistEntry {
+	std::string path;
+	bool bytes;			// start and end are byte offsets, not frames
+	long long start;
+	long long end;			// -1: to the end of the clip
+} PlaylistEntry;
+
+class PlaylistInput
+{
+private:
+	//an opened clip, positioned at the first frame of its range
+	struct Clip {
+		FILE *fp;
+		bool y4m;
+		long long left;		// frames left, -1 for a y4m clip read to its end
+		int step;		// bytes per frame in the file
+		long long pos;		// offset of the next frame
+		long long end;		// offset of the end of the range, -1 without one
+		long long ahead;	// prefetched up to here
+	};
+
+	enum { NEXT_NONE, NEXT_PENDING, NEXT_OPENING, NEXT_DONE };
+
+	std::vector<PlaylistEntry> d_entries;
+	int d_width;
+	int d_height;
+	AVPixelFormat d_fmt;
+	AVRational d_fps;		// 0:0 unless the first clip is y4m
+	AVRational d_sar;
+	int d_frame_bytes;
+	int d_prefetch;			// frames to prefetch, of the next clip and within ranges
+
+	TaskPool *d_pool;
+	Clip d_current;
+	int d_index;			// entry of d_current
+	bool d_failed;
+
+	//the clip after d_current, opened by a pool task or by next() itself
+	Clip d_next;
+	bool d_next_ok;
+	std::atomic<int> d_next_state;
+	std::mutex d_mutex;
+	std::condition_variable d_opened;
+
+	//open entry index into *clip; prints why it failed
+	bool open_clip(int index, Clip *clip) {
+		const PlaylistEntry &entry = d_entries[index];
+		const char *path = entry.path.c_str();
+		clip->fp = fopen(path, "rb");
+		clip->y4m = false;
+		clip->left = 0;
+		clip->end = -1;
+		if (!clip->fp) {
+			printf("Could not open %s\n", path);
+			return false;
+		}
+		long long offset;
+		clip->step = d_frame_bytes;
+		if (y4m_is_y4m(path)) {
+			Y4MInfo info;
+			if (y4m_read_header(clip->fp, &info) < 0) {
+				printf("Could not read the y4m header of %s\n", path);
+				return false;
+			}
+			if (info.width != d_width || info.height != d_height || info.pix_fmt != d_fmt) {
+				printf("%s is %dx%d %s, the playlist %dx%d %s\n", path, info.width, info.height,
+				       av_get_pix_fmt_name(info.pix_fmt), d_width, d_height, av_get_pix_fmt_name(d_fmt));
+				return false;
+			}
+			if (entry.bytes) {
+				printf("Byte ranges apply to raw clips only: %s\n", path);
+				return false;
+			}
+			clip->y4m = true;
+			clip->left = entry.end < 0 ? -1 : entry.end - entry.start;
+			offset = y4m_frame_offset(&info, (int)entry.start);
+			clip->step += 6;
+			if (entry.end >= 0)
+				clip->end = offset + clip->left * clip->step;
+		} else {
+			if (playlist_seek(clip->fp, 0, SEEK_END) < 0) {
+				printf("Playlist clips must be files: %s\n", path);
+				return false;
+			}
+			long long size = playlist_tell(clip->fp);
+			long long first = entry.bytes ? entry.start : entry.start * d_frame_bytes;
+			long long last = entry.end < 0 ? size : entry.bytes ? entry.end : entry.end * d_frame_bytes;
+			if (last > size)
+				last = size;
+			clip->left = last > first ? (last - first) / d_frame_bytes : 0;
+			offset = first;
+			if (entry.end >= 0 || entry.start > 0)
+				clip->end = offset + clip->left * clip->step;
+		}
+		if (playlist_seek(clip->fp, offset, SEEK_SET) < 0) {
+			printf("Could not seek to the range of %s\n", path);
+			return false;
+		}
+		clip->pos = clip->ahead = offset;
+#if !defined(_WIN32) && defined(POSIX_FADV_RANDOM)
+		if (clip->end >= 0)
+			posix_fadvise(fileno(clip->fp), 0, 0, POSIX_FADV_RANDOM);
+#endif
+		//the OS reads the start on its own while the previous clip is encoded
+		prefetch(clip, d_prefetch);
+		return true;
+	}
+
+	//have the OS read at least ahead frames from clip->pos on in the background
+	void prefetch(Clip *clip, int ahead) {
+		if (clip->ahead >= clip->pos + (long long)ahead * clip->step && clip->ahead > clip->pos)
+			return;
+		//a window at a time, so the reader asks once per PLAYLIST_PREFETCH frames
+		long long until = clip->pos + 2LL * d_prefetch * clip->step;
+		if (clip->end >= 0 && until > clip->end)
+			until = clip->end;
+		if (until <= clip->ahead)
+			return;
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+		posix_fadvise(fileno(clip->fp), clip->ahead, until - clip->ahead, POSIX_FADV_WILLNEED);
+#endif
+		clip->ahead = until;
+	}
+
+	//open d_next unless another thread has started on it; then wait for it
+	void open_next() {
+		int expected = NEXT_PENDING;
+		if (d_next_state.compare_exchange_strong(expected, NEXT_OPENING)) {
+			d_next_ok = open_clip(d_index + 1, &d_next);
+			std::unique_lock<std::mutex> lock(this->d_mutex);
+			d_next_state = NEXT_DONE;
+			this->d_opened.notify_all();
+		}
+	}
+
+	void schedule_next() {
+		if (d_index + 1 >= (int)d_entries.size())
+			return;
+		d_next_state = NEXT_PENDING;
+		d_pool->submit([this]{ this->open_next(); });
+	}
+
+	static void close_clip(Clip *clip) {
+		if (clip->fp)
+			fclose(clip->fp);
+		clip->fp = NULL;
+	}
+
+	static std::string relative_to(const std::string &dir, const std::string &path) {
+		return path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':') ? path : dir + path;
+	}
+
+	//parse one line of an EDL into *entry, *source set by "source" lines; false for other lines
+	static bool parse_edl_line(char *line, const std::string &dir, std::string *source,
+	                           PlaylistEntry *entry, bool *bad) {
+		*bad = false;
+		line[strcspn(line, "\r\n")] = 0;
+		char *p = line + strspn(line, " \t");
+		if (!*p || *p == '#')
+			return false;
+		if (!strncmp(p, "source", 6) && (p[6] == ' ' || p[6] == '\t')) {
+			std::string path(p + 7 + strspn(p + 7, " \t"));
+			path.erase(path.find_last_not_of(" \t") + 1);
+			*bad = path.empty();
+			if (!*bad)
+				*source = relative_to(dir, path);
+			return false;
+		}
+		entry->path = *source;
+		entry->bytes = false;
+		*bad = source->empty() || sscanf(p, "%lld %lld", &entry->start, &entry->end) != 2 ||
+		       entry->start < 0 || entry->end < entry->start;
+		return true;
+	}
+
+	//parse one line of a playlist into *entry; false for a blank or comment line
+	static bool parse_line(char *line, const std::string &dir, PlaylistEntry *entry, bool *bad) {
+		*bad = false;
+		line[strcspn(line, "\r\n")] = 0;
+		char *p = line + strspn(line, " \t");
+		if (!*p || *p == '#')
+			return false;
+		//the path runs up to the last " frames" or " bytes", or to the end
+		char *range = NULL;
+		for (char *s = p; (s = strpbrk(s, " \t")) != NULL; s++) {
+			char *word = s + strspn(s, " \t");
+			if (!strncmp(word, "frames ", 7) || !strncmp(word, "bytes ", 6))
+				range = s;
+		}
+		std::string path = range ? std::string(p, range - p) : std::string(p);
+		path.erase(path.find_last_not_of(" \t") + 1);
+		entry->path = relative_to(dir, path);
+		entry->bytes = false;
+		entry->start = 0;
+		entry->end = -1;
+		if (range) {
+			char kind[8];
+			int n = sscanf(range, " %7s %lld %lld", kind, &entry->start, &entry->end);
+			entry->bytes = kind[0] == 'b';
+			*bad = n < 2 || entry->start < 0 || (n == 3 && entry->end < entry->start);
+		}
+		return true;
+	}
+
+public:
+	PlaylistInput() : d_width(0), d_height(0), d_fmt(AV_PIX_FMT_YUV420P), d_frame_bytes(0),
+	                  d_prefetch(0), d_pool(NULL), d_index(0), d_failed(false), d_next_ok(false),
+	                  d_next_state(NEXT_NONE) {
+		d_fps.num = d_fps.den = 0;
+		d_sar.num = 0;
+		d_sar.den = 1;
+		d_current.fp = d_next.fp = NULL;
+	}
+
+	~PlaylistInput() {
+		close_clip(&d_current);
+		close_clip(&d_next);
+	}
+
+	/*
+	 * Read the playlist, or with edl the EDL, at path and open its first
+	 * clip. Raw clips are width x height fmt unless the first clip is
+	 * y4m. Prints why it failed.
+	 */
+	bool open(const char *path, bool edl, int width, int height, AVPixelFormat fmt, int prefetch) {
+		FILE *fp = fopen(path, "r");
+		if (!fp) {
+			printf("Could not open %s\n", path);
+			return false;
+		}
+		std::string dir(path);
+		size_t slash = dir.find_last_of("/\\");
+		dir = slash == std::string::npos ? std::string() : dir.substr(0, slash + 1);
+		char line[4096];
+		int number = 0;
+		std::string source;
+		while (fgets(line, sizeof(line), fp)) {
+			PlaylistEntry entry;
+			bool bad;
+			number++;
+			bool found = edl ? parse_edl_line(line, dir, &source, &entry, &bad)
+			                 : parse_line(line, dir, &entry, &bad);
+			if (bad) {
+				printf("Bad %s on line %d of %s\n", edl ? "source or range" : "range", number, path);
+				fclose(fp);
+				return false;
+			}
+			if (found)
+				d_entries.push_back(entry);
+		}
+		fclose(fp);
+		if (d_entries.empty()) {
+			printf("No %s in %s\n", edl ? "ranges" : "clips", path);
+			return false;
+		}
+		d_width = width;
+		d_height = height;
+		d_fmt = fmt;
+		d_prefetch = prefetch;
+		if (y4m_is_y4m(d_entries[0].path.c_str())) {
+			//the first clip sets the geometry
+			Y4MInfo info;
+			FILE *first = fopen(d_entries[0].path.c_str(), "rb");
+			if (!first || y4m_read_header(first, &info) < 0) {
+				printf("Could not read the y4m header of %s\n", d_entries[0].path.c_str());
+				if (first)
+					fclose(first);
+				return false;
+			}
+			fclose(first);
+			d_width = info.width;
+			d_height = info.height;
+			d_fmt = info.pix_fmt;
+			d_fps = info.fps;
+			d_sar = info.sar;
+		}
+		d_frame_bytes = avpicture_get_size(d_fmt, d_width, d_height);
+		return open_clip(0, &d_current);
+	}
+
+	int clips() const { return (int)d_entries.size(); }
+	int width() const { return d_width; }
+	int height() const { return d_height; }
+	AVPixelFormat pix_fmt() const { return d_fmt; }
+	//frame rate of the first clip, 0:0 if it is raw
+	AVRational frame_rate() const { return d_fps; }
+	AVRational sample_aspect_ratio() const { return d_sar; }
+
+	//true once next() stopped on a clip that could not be opened
+	bool failed() const { return d_failed; }
+
+	//start opening the second clip on pool while the first is read
+	void start(TaskPool &pool) {
+		d_pool = &pool;
+		schedule_next();
+	}
+
+	/*
+	 * The file to read the next frame's planes from, positioned at
+	 * them, NULL after the last frame of the last clip.
+	 */
+	FILE *next() {
+		while (true) {
+			if (d_current.fp && d_current.left != 0) {
+				if (!d_current.y4m || y4m_read_frame_header(d_current.fp) == 0) {
+					if (d_current.left > 0)
+						d_current.left--;
+					if (d_current.end >= 0)
+						prefetch(&d_current, d_prefetch / 2);
+					d_current.pos += d_current.step;
+					return d_current.fp;
+				}
+				//a y4m clip shorter than its range ends early
+			}
+			close_clip(&d_current);
+			if (d_failed || d_index + 1 >= (int)d_entries.size())
+				return NULL;
+			if (d_next_state == NEXT_NONE)
+				d_next_state = NEXT_PENDING;	// not started, opened here
+			open_next();
+			{
+				std::unique_lock<std::mutex> lock(this->d_mutex);
+				this->d_opened.wait(lock, [=]{ return this->d_next_state == NEXT_DONE; });
+			}
+			d_current = d_next;
+			d_next.fp = NULL;
+			d_index++;
+			if (!d_next_ok) {
+				d_failed = true;
+				close_clip(&d_current);
+				return NULL;
+			}
+			schedule_next();
+		}
+	}
+};
+
+#endif
@@ -14,14 +14,16 @@
  * ͨ��ѧϰ�����ӿ����˽�FFmpeg�ı������̡�
  * This software encode YUV420P data to video bitstream
  * (Such as H.264, H.265, VP8, MPEG2 etc).
- * It only uses libavcodec to encode video (without libavformat)
+ * It encodes with libavcodec. libavformat is used to demux compressed
+ * input (--decode) and to write the Matroska archive, and libswscale
+ * converts input that is not YUV420P.
  * It's the simplest video encoding software based on FFmpeg. 
  * Suitable for beginner of FFmpeg 
  */
 
 
 #include <stdio.h>
-#include <omp.h>
+#include <limits.h>
 #include <vector>
 
 #include <stdint.h>
@@ -36,6 +38,12 @@ extern "C"
 #include "libavutil/opt.h"
 #include "libavcodec/avcodec.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/adler32.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/cpu.h"
+#include "libswscale/swscale.h"
+#include "libavformat/avformat.h"
 };
 #else
 //Linux...
@@ -46,6 +54,12 @@ extern "C"
 #include <libavutil/opt.h>
 #include <libavcodec/avcodec.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/adler32.h>
+#include <libavutil/intreadwrite.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/cpu.h>
+#include <libswscale/swscale.h>
+#include <libavformat/avformat.h>
 #ifdef __cplusplus
 };
 #endif
@@ -54,11 +68,241 @@ extern "C"
 #include <mutex>
 #include <condition_variable>
 #include <deque>
+#include <map>
+#include <atomic>
+#include <memory>
+#include <chrono>
+
+#include "task_pool.h"
+#include "topology.h"
+#include "frame_pool.h"
+#include "ingest.h"
+#include "cpu_budget.h"
+#include "y4m_reader.h"
+#include "timecode_reader.h"
+#include "stream_input.h"
+#include "convert_stage.h"
+#include "ingest_kernels.h"
+#include "auto_crop.h"
+#include "decode_input.h"
+#include "playlist_input.h"
+#include "mosaic.h"
 
 //Add ability to test different codecs
 #define TEST_H264  1
 #define TEST_HEVC  0
 
+/*
+ * Intra-only (mezzanine) mode
+ *
+ * 	Every frame is coded as a keyframe, so frames do not depend on
+ * 	each other and can be spread round-robin over a pool of
+ * 	independent codec contexts, one encoding stage each.
+ * 	The writing stage puts the packets back into pts order.
+ * 	With H.264 it also renumbers IDRs that would share their
+ * 	neighbour's idr_pic_id, see idr_rewrite.h.
+ *
+ * 	INTRA_MJPEG: 1 for MJPEG, 0 for H.264 intra
+ *
+ * 	INTRA_SCALE: use between INTRA_POOL_MIN and INTRA_POOL_SIZE
+ * 	contexts, rechecked every INTRA_SCALE_INTERVAL frames from the
+ * 	queue depths and encode times; 0 keeps INTRA_POOL_SIZE busy
+ */
+#define INTRA_ONLY       0
+#define INTRA_POOL_SIZE  4
+#define INTRA_MJPEG      0
+#define INTRA_SCALE      1
+#define INTRA_POOL_MIN   1
+#define INTRA_SCALE_INTERVAL 25
+
+#if INTRA_ONLY
+#include "idr_rewrite.h"
+#endif
+
+/*
+ * Pipeline scheduling
+ *
+ * 	POOL_THREADS: threads of the work-stealing pool, 0 for one per core
+ * 	READ_AHEAD: frames the reader may have in flight
+ */
+#define POOL_THREADS     0
+#define READ_AHEAD       16
+
+/*
+ * Thread placement, see topology.h
+ *
+ * 	Pins the pool threads, and through the main thread libavcodec's
+ * 	own threads, to PLACEMENT_CPUS ("" for all CPUs), runs one pool
+ * 	per NUMA node and keeps every encoder's frames on its node.
+ * 	The pool sizes then follow the selected CPUs, not POOL_THREADS.
+ *
+ * 	PLACEMENT_NO_SMT: use only one hardware thread of every core
+ */
+#define PLACEMENT        0
+#define PLACEMENT_CPUS   ""
+#define PLACEMENT_NO_SMT 0
+
+/*
+ * Frame buffers, see frame_pool.h
+ *
+ * 	FRAME_HUGEPAGES: back the raw frames with 2 MB pages, explicit
+ * 	ones if reserved (vm.nr_hugepages), else transparent hugepages
+ * 	FRAME_MLOCK: lock the raw frames in RAM, for live jobs
+ */
+#define FRAME_HUGEPAGES  0
+#define FRAME_MLOCK      0
+
+/*
+ * Row alignment of the raw frames in bytes, see ingest.h. 32 suits
+ * AVX2, 64 lets AVX-512 code load whole rows aligned.
+ */
+#define INGEST_ALIGN     32
+
+/*
+ * Input conversion, see convert_stage.h
+ *
+ * 	Raw input in another pixel format (--pix-fmt nv12, yuyv422,
+ * 	uyvy422, rgb24, bgra, p010le, ...) is converted to 4:2:0 by
+ * 	libswscale on the pool, CONVERT_BANDS bands per frame in
+ * 	parallel, 0 for one per pool thread.
+ *
+ * 	INGEST_KERNELS: NV12, BGRA, YUV422P and YUV444P skip libswscale
+ * 	and are converted by the reader with the SIMD kernels of
+ * 	ingest_kernels.h
+ *
+ * 	CHROMA_420: 4:2:2 and 4:4:4 input is decimated to 4:2:0; 0
+ * 	encodes it as it is, for mezzanine output in the High 4:2:2 /
+ * 	High 4:4:4 profiles (not with MJPEG)
+ */
+#define CONVERT_BANDS    0
+#define INGEST_KERNELS   1
+#define CHROMA_420       1
+
+/*
+ * Black border cropping, see auto_crop.h
+ *
+ * 	AUTO_CROP: scan the first AUTO_CROP_SECONDS of 8-bit raw or y4m
+ * 	file input for black borders, no sample above AUTO_CROP_BLACK,
+ * 	and encode the picture only, in multiples of 16
+ *
+ * 	AUTO_CROP_PAD: pad sizes that are no multiple of 16 up to one
+ */
+#define AUTO_CROP         0
+#define AUTO_CROP_SECONDS 2
+#define AUTO_CROP_BLACK   24
+#define AUTO_CROP_PAD     0
+
+/*
+ * Compressed input, see decode_input.h
+ *
+ * 	--decode demuxes and decodes the input instead of reading raw
+ * 	frames, with DECODE_THREADS decoder threads, 0 for one per core
+ */
+#define DECODE_THREADS   0
+
+/*
+ * Playlist input, see playlist_input.h
+ *
+ * 	A .playlist input, or --playlist, lists raw and y4m clips or
+ * 	frame ranges of them, encoded back to back as one input. The
+ * 	next clip is opened on the pool ahead of time, with its first
+ * 	PLAYLIST_PREFETCH frames read ahead by the OS.
+ *
+ * 	A .edl input, or --edl, lists frame ranges of a source in any
+ * 	order; ranges are read PLAYLIST_PREFETCH frames ahead and no
+ * 	further than their end.
+ */
+#define PLAYLIST_PREFETCH 8
+
+/*
+ * Mosaic input, see mosaic.h
+ *
+ * 	A .mosaic input, or --mosaic, lays out raw YUV420P inputs on
+ * 	one canvas, each read MOSAIC_QUEUE frames ahead on a thread of
+ * 	its own. An input with no frame MOSAIC_WAIT_MS after the
+ * 	reader asked shows its last frame again. Inputs that have sent
+ * 	nothing MOSAIC_START_MS after the start do not keep it running.
+ */
+#define MOSAIC_QUEUE     3
+#define MOSAIC_WAIT_MS   40
+#define MOSAIC_START_MS  5000
+
+/*
+ * Packed raw input, see packed_input.h; needs libzstd (-lzstd)
+ *
+ * 	A .yuvz input holds every frame zstd-compressed on its own,
+ * 	and frames are decompressed on the pool into the encoders'
+ * 	frames. --pack writes the input, raw or y4m, as .yuvz at
+ * 	zstd level PACK_LEVEL.
+ */
+#define PACKED_INPUT     0
+#define PACK_LEVEL       3
+
+#if PACKED_INPUT
+#include "packed_input.h"
+#endif
+
+/*
+ * Lossless archival mode
+ *
+ * 	Encodes with FFV1 version 3, cut into ARCHIVE_SLICES slices
+ * 	that libavcodec encodes in parallel, each protected by a CRC.
+ * 	FFV1 has no elementary stream syntax of its own, so packets
+ * 	are muxed into Matroska, see open_archive().
+ *
+ * 	ARCHIVE_VERIFY: decode every packet back in the writing stage
+ * 	and compare it with a checksum of the source frame
+ */
+#define ARCHIVE_FFV1     0
+#define ARCHIVE_SLICES   16
+#define ARCHIVE_VERIFY   1
+
+/*
+ * Live control channel, see live_control.h
+ *
+ * 	Lets a live channel change bitrate/VBV and force IDRs through
+ * 	CONTROL_FIFO without reopening the encoder (libx264 only).
+ */
+#define LIVE_CONTROL     0
+#define CONTROL_FIFO     "/tmp/simplest_encoder.ctl"
+
+#if LIVE_CONTROL
+#include "live_control.h"
+#endif
+
+/*
+ * Chunk farm, see chunk_farm.h
+ *
+ * 	Cuts the input into independent chunks of CHUNK_FRAMES frames
+ * 	and encodes them on CHUNK_WORKERS local worker processes, or
+ * 	through a job spool in CHUNK_SPOOL_DIR that workers on other
+ * 	nodes serve with --spool-worker <dir>.
+ */
+#define CHUNK_FARM       0
+#define CHUNK_WORKERS    4
+#define CHUNK_FRAMES     250
+#define CHUNK_RETRIES    3
+#define CHUNK_SPOOL_DIR  ""	// shared directory, "" for local workers
+#define CHUNK_TIMEOUT    600	// seconds before a spool claim is put back
+
+#if CHUNK_FARM
+#include "chunk_farm.h"
+#endif
+
+/*
+ * Multi-stream mode, see multi_stream.h
+ *
+ * 	Encodes all streams listed in STREAM_LIST concurrently as
+ * 	resumable jobs on the task pool, STREAM_SLICE frames per turn.
+ */
+#define MULTI_STREAM     0
+#define STREAM_LIST      "streams.txt"
+#define STREAM_SLICE     4
+
+#if MULTI_STREAM
+#include "multi_stream.h"
+#endif
+
 //Source: (Slightly modified)
 //https://stackoverflow.com/questions/12805041/c-equivalent-to-javas-blockingqueue
 template <typename T>
@@ -88,18 +332,206 @@ public:
     }
 };
 
+#if INTRA_ONLY
+/*
+ * Allocate and open one codec context of the intra-only pool.
+ *
+ * 	Rate control is constant quality: each context only sees
+ * 	some of the frames, so a per-context bit_rate would not add
+ * 	up to the intended stream rate.
+ */
+static AVCodecContext *open_intra_encoder(AVCodec *codec, int width, int height, AVRational time_base,
+					  AVPixelFormat pix_fmt)
+{
+	AVCodecContext *ctx = avcodec_alloc_context3(codec);
+	if (!ctx)
+		return NULL;
+	ctx->width = width;
+	ctx->height = height;
+	ctx->time_base = time_base;
+	ctx->gop_size = 1;
+	ctx->max_b_frames = 0;
+	ctx->thread_count = 1;	// parallelism comes from the pool
+	if (codec->id == AV_CODEC_ID_MJPEG) {
+		ctx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+		ctx->flags |= CODEC_FLAG_QSCALE;
+		ctx->global_quality = FF_QP2LAMBDA * 3;
+	} else {
+		ctx->pix_fmt = pix_fmt;
+		av_opt_set(ctx->priv_data, "preset", "slow", 0);
+		av_opt_set(ctx->priv_data, "crf", "18", 0);
+	}
+	if (avcodec_open2(ctx, codec, NULL) < 0) {
+		avcodec_free_context(&ctx);
+		return NULL;
+	}
+	return ctx;
+}
+#endif
+
+static int threads_total(const std::vector<std::unique_ptr<TaskPool> > &pools)
+{
+	int threads = 0;
+	for (size_t g = 0; g < pools.size(); g++)
+		threads += pools[g]->size();
+	return threads;
+}
+
+#if ARCHIVE_FFV1
+/*
+ * Open path as a Matroska file with one stream for ctx and write its
+ * header. Matroska carries FFV1 version 3 with its configuration
+ * record, so any FFmpeg restores the source from it:
+ * ffmpeg -i archive.mkv -f rawvideo archive.yuv
+ */
+static AVFormatContext *open_archive(const char *path, AVCodecContext *ctx)
+{
+	AVFormatContext *fmt = NULL;
+	av_register_all();
+	if (avformat_alloc_output_context2(&fmt, NULL, "matroska", path) < 0)
+		return NULL;
+	AVStream *st = avformat_new_stream(fmt, NULL);
+	if (!st || avcodec_copy_context(st->codec, ctx) < 0 ||
+	    avio_open(&fmt->pb, path, AVIO_FLAG_WRITE) < 0) {
+		avformat_free_context(fmt);
+		return NULL;
+	}
+	st->codec->codec_tag = 0;
+	st->time_base = ctx->time_base;
+	if (avformat_write_header(fmt, NULL) < 0) {
+		avio_close(fmt->pb);
+		avformat_free_context(fmt);
+		return NULL;
+	}
+	return fmt;
+}
+
+//pkt stays the caller's, its pts in ctx's time base
+static int write_archive_packet(AVFormatContext *fmt, AVCodecContext *ctx, AVPacket *pkt)
+{
+	AVPacket out = *pkt;
+	out.stream_index = 0;
+	av_packet_rescale_ts(&out, ctx->time_base, fmt->streams[0]->time_base);
+	return av_write_frame(fmt, &out);
+}
+
+//write the trailer and close; the size of the archive, -1 on error
+static int64_t close_archive(AVFormatContext *fmt)
+{
+	int ret = av_write_trailer(fmt);
+	int64_t size = avio_size(fmt->pb);
+	avio_close(fmt->pb);
+	avformat_free_context(fmt);
+	return ret < 0 ? -1 : size;
+}
+
+//Adler-32 over the visible samples of every plane, padding excluded
+static uint32_t frame_checksum(const AVFrame *frame)
+{
+	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+	unsigned long sum = 1;
+	for (int p = 0; p < 3 && frame->data[p]; p++) {
+		int w = p ? FF_CEIL_RSHIFT(frame->width, desc->log2_chroma_w) : frame->width;
+		int h = p ? FF_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height;
+		w *= desc->comp[p].depth_minus1 >= 8 ? 2 : 1;	// high bit depth samples are 16-bit
+		for (int y = 0; y < h; y++)
+			sum = av_adler32_update(sum, frame->data[p] + y * frame->linesize[p], w);
+	}
+	return (uint32_t)sum;
+}
+#endif
 
 int main(int argc, char* argv[])
 {
+#if CHUNK_FARM
+	if (argc > 2 && !strcmp(argv[1], "--spool-worker")) {
+		avcodec_register_all();
+		return run_spool_worker(argv[2]);
+	}
+#endif
+	//--bench-kernels: check and time the ingest kernels, see ingest_kernels.h
+	if (argc > 1 && !strcmp(argv[1], "--bench-kernels")) {
+		int ret = run_kernel_bench();
+		return run_crop_bench() < 0 ? -1 : ret;
+	}
+
+	/*
+	 * --cpu-budget <cores>: average CPU use to stay under, see cpu_budget.h
+	 * --size <W>x<H>: size of raw input frames
+	 * --y4m: the input is y4m whatever its name, e.g. on stdin
+	 * --pix-fmt <name>: pixel format of raw input, see CONVERT_BANDS
+	 * --decode: the input is a compressed file, see DECODE_THREADS
+	 * --playlist: the input lists clips to encode as one, see PLAYLIST_PREFETCH
+	 * --edl: the input lists frame ranges to cut into one encode, likewise
+	 * --mosaic: the input lays out inputs to composite, see MOSAIC_QUEUE
+	 * --timecodes <file>: frame times of variable frame rate input, see timecode_reader.h
+	 * --pack: write the input to the output as .yuvz, see PACKED_INPUT
+	 * [input [output]]: replace the file names below; a .y4m input
+	 * brings its own size and frame rate, see y4m_reader.h, and "-"
+	 * or a named pipe is read until EOF, see stream_input.h
+	 */
+	CpuBudget budget;
+	const char *arg_in = NULL, *arg_out = NULL;
+	int arg_w = 0, arg_h = 0;
+	bool arg_y4m = false;
+	bool arg_decode = false;
+	bool arg_playlist = false;
+	bool arg_edl = false;
+	bool arg_mosaic = false;
+	const char *arg_tc = NULL;
+#if PACKED_INPUT
+	bool arg_pack = false;
+#endif
+	AVPixelFormat in_fmt = AV_PIX_FMT_YUV420P;
+	for (int k = 1; k < argc; k++) {
+		if (!strcmp(argv[k], "--cpu-budget") && k + 1 < argc) {
+			if (!budget.set(atof(argv[++k]))) {
+				printf("Bad CPU budget %s\n", argv[k]);
+				return -1;
+			}
+		} else if (!strcmp(argv[k], "--size") && k + 1 < argc) {
+			if (sscanf(argv[++k], "%dx%d", &arg_w, &arg_h) != 2 || arg_w <= 0 || arg_h <= 0) {
+				printf("Bad frame size %s\n", argv[k]);
+				return -1;
+			}
+		} else if (!strcmp(argv[k], "--y4m")) {
+			arg_y4m = true;
+		} else if (!strcmp(argv[k], "--decode")) {
+			arg_decode = true;
+		} else if (!strcmp(argv[k], "--playlist")) {
+			arg_playlist = true;
+		} else if (!strcmp(argv[k], "--edl")) {
+			arg_edl = true;
+		} else if (!strcmp(argv[k], "--mosaic")) {
+			arg_mosaic = true;
+		} else if (!strcmp(argv[k], "--timecodes") && k + 1 < argc) {
+			arg_tc = argv[++k];
+#if PACKED_INPUT
+		} else if (!strcmp(argv[k], "--pack")) {
+			arg_pack = true;
+#endif
+		} else if (!strcmp(argv[k], "--pix-fmt") && k + 1 < argc) {
+			in_fmt = av_get_pix_fmt(argv[++k]);
+			if (in_fmt == AV_PIX_FMT_NONE) {
+				printf("Unknown pixel format %s\n", argv[k]);
+				return -1;
+			}
+		} else if (!arg_in) {
+			arg_in = argv[k];
+		} else if (!arg_out) {
+			arg_out = argv[k];
+		}
+	}
+
 	// Initialize variables
 	AVCodec *pCodec;
     AVCodecContext *pCodecCtx= NULL;
-    int i, ret, got_output;
+    int ret;
     FILE *fp_in;
+#if !ARCHIVE_FFV1
 	FILE *fp_out;
+#endif
     AVFrame *pFrame;
-    AVPacket pkt;
-	int y_size;
 	int framecnt=0;
 
 
@@ -112,7 +544,13 @@ int main(int argc, char* argv[])
 	char filename_in[]="../1280x720.yuv";
 
 // Use set codec to generate output codec
-#if TEST_HEVC
+#if INTRA_ONLY && INTRA_MJPEG
+	AVCodecID codec_id=AV_CODEC_ID_MJPEG;
+	char filename_out[]="1280x720.mjpeg";
+#elif ARCHIVE_FFV1
+	AVCodecID codec_id=AV_CODEC_ID_FFV1;
+	char filename_out[]="1280x720.mkv";
+#elif TEST_HEVC
 	AVCodecID codec_id=AV_CODEC_ID_HEVC;
 	//char filename_out[]="ds.hevc";
 	//char filename_out[]="output_640x360p.hevc";
@@ -145,35 +583,354 @@ int main(int argc, char* argv[])
 
 	int in_w=1280,in_h=720;	
 	int framenum=677;	
+	AVRational time_base = { 1, 25 };
+
+	const char *in_path = arg_in ? arg_in : filename_in;
+	const char *out_path = arg_out ? arg_out : filename_out;
+	Y4MInfo y4m;
+	const Y4MInfo *in_y4m = NULL;
 
 	avcodec_register_all();
 
+#if MULTI_STREAM
+	return run_multi_stream(STREAM_LIST, codec_id);
+#endif
+
+	//Input: decoded from a container, a playlist of clips, a mosaic, or raw frames. A y4m header sets
+	//the geometry and frame rate, EOF the frame count
+	bool in_stream = false;
+	bool in_packed = false;
+	fp_in = NULL;
+	std::unique_ptr<DecodeInput> decoder;
+	std::unique_ptr<PlaylistInput> playlist;
+	MosaicLayout mosaic_layout;
+	bool in_mosaic = false;
+	AVRational in_sar = { 0, 1 };
+	if (arg_decode) {
+		if (arg_y4m || arg_w || in_fmt != AV_PIX_FMT_YUV420P) {
+			printf("--y4m, --size and --pix-fmt apply to raw input only\n");
+			return -1;
+		}
+		av_register_all();
+		decoder.reset(new DecodeInput);
+		if (!decoder->open(in_path, DECODE_THREADS))
+			return -1;
+		AVRational rate = decoder->frame_rate();
+		in_fmt = decoder->pix_fmt();
+		in_w = decoder->width();
+		in_h = decoder->height();
+		time_base.num = rate.den;
+		time_base.den = rate.num;
+		in_sar = decoder->sample_aspect_ratio();
+		framenum = INT_MAX;
+		printf("Decode: %s %dx%d %s, %d/%d fps, %d threads\n", decoder->codec_name(), in_w, in_h,
+		       av_get_pix_fmt_name(in_fmt), rate.num, rate.den, decoder->threads());
+	} else if (arg_mosaic || mosaic_is_mosaic(in_path)) {
+		if (arg_y4m || arg_w || in_fmt != AV_PIX_FMT_YUV420P) {
+			printf("--y4m, --size and --pix-fmt apply to raw input only, a mosaic sets its own\n");
+			return -1;
+		}
+		if (!mosaic_read_layout(in_path, &mosaic_layout))
+			return -1;
+		in_mosaic = true;
+		in_w = mosaic_layout.width;
+		in_h = mosaic_layout.height;
+		time_base.num = mosaic_layout.fps.den;
+		time_base.den = mosaic_layout.fps.num;
+		framenum = INT_MAX;	// until every input has ended
+		printf("Mosaic: %d inputs on %dx%d, %d/%d fps\n", (int)mosaic_layout.tiles.size(), in_w, in_h,
+		       time_base.den, time_base.num);
+	} else if (arg_playlist || arg_edl || playlist_is_playlist(in_path) || playlist_is_edl(in_path)) {
+		bool edl = arg_edl || (!arg_playlist && playlist_is_edl(in_path));
+		if (arg_y4m || !strcmp(in_path, "-")) {
+			printf("A playlist or EDL is a file listing the clips\n");
+			return -1;
+		}
+		if (arg_w) {
+			in_w = arg_w;
+			in_h = arg_h;
+		}
+		playlist.reset(new PlaylistInput);
+		if (!playlist->open(in_path, edl, in_w, in_h, in_fmt, PLAYLIST_PREFETCH))
+			return -1;
+		in_w = playlist->width();
+		in_h = playlist->height();
+		in_fmt = playlist->pix_fmt();
+		AVRational rate = playlist->frame_rate();
+		if (rate.num > 0) {
+			time_base.num = rate.den;
+			time_base.den = rate.num;
+		}
+		in_sar = playlist->sample_aspect_ratio();
+		framenum = INT_MAX;	// to the end of the last clip
+		printf("%s: %d %s, %dx%d %s, %d/%d fps\n", edl ? "EDL" : "Playlist", playlist->clips(),
+		       edl ? "ranges" : "clips", in_w, in_h,
+		       av_get_pix_fmt_name(in_fmt), time_base.den, time_base.num);
+	} else {
+		fp_in = stream_input_open(in_path, &in_stream);
+		if (!fp_in) {
+			printf("Could not open %s\n", in_path);
+			return -1;
+		}
+		if (arg_w) {
+			in_w = arg_w;
+			in_h = arg_h;
+		}
+		if (in_stream)
+			framenum = INT_MAX;	// a pipe has no length, read until EOF
+		if (arg_y4m || y4m_is_y4m(in_path)) {
+			if (y4m_read_header(fp_in, &y4m) < 0) {
+				printf("Could not read the y4m header of %s\n", in_path);
+				return -1;
+			}
+			if (in_fmt != AV_PIX_FMT_YUV420P) {
+				printf("--pix-fmt applies to raw input only\n");
+				return -1;
+			}
+			in_fmt = y4m.pix_fmt;
+			in_w = y4m.width;
+			in_h = y4m.height;
+			time_base.num = y4m.fps.den;
+			time_base.den = y4m.fps.num;
+			framenum = INT_MAX;
+			in_y4m = &y4m;
+			in_sar = y4m.sar;
+			printf("Y4M input: %dx%d, %d/%d fps, interlace %c\n",
+			       in_w, in_h, y4m.fps.num, y4m.fps.den, y4m.interlace);
+		}
+	}
+#if PACKED_INPUT
+	PackedInfo packed;
+	std::vector<long long> packed_offsets;
+	in_packed = fp_in && !in_y4m && packed_is_packed(in_path);
+	if (in_packed) {
+		if (in_stream || packed_read_header(fp_in, &packed, &packed_offsets) < 0) {
+			printf("Could not read the .yuvz header and index of %s\n", in_path);
+			return -1;
+		}
+		in_fmt = packed.pix_fmt;
+		in_w = packed.width;
+		in_h = packed.height;
+		time_base.num = packed.fps.den;
+		time_base.den = packed.fps.num;
+		framenum = packed.frames;
+		printf("Packed input: %dx%d %s, %d/%d fps, %d frames\n", in_w, in_h,
+		       av_get_pix_fmt_name(in_fmt), packed.fps.num, packed.fps.den, framenum);
+	}
+	if (arg_pack) {
+		if (!fp_in || in_packed) {
+			printf("--pack takes raw or y4m input\n");
+			return -1;
+		}
+		FILE *fp_pack = fopen(out_path, "wb");
+		if (!fp_pack) {
+			printf("Could not open %s\n", out_path);
+			return -1;
+		}
+		AVRational fps = { time_base.den, time_base.num };
+		ret = packed_write(fp_in, in_y4m, fp_pack, in_w, in_h, in_fmt, fps, PACK_LEVEL);
+		fclose(fp_pack);
+		return ret;
+	}
+#endif
+	//variable frame rate: the frames are timed by the timecode file, not by the frame rate
+	TimecodeInfo tc;
+	const TimecodeInfo *in_tc = NULL;
+	if (arg_tc) {
+		if (timecode_read(arg_tc, &tc) < 0) {
+			printf("Could not read the timecode v2 file %s\n", arg_tc);
+			return -1;
+		}
+		in_tc = &tc;
+		time_base = tc.time_base;
+		printf("Timecodes: %d frames, time base 1/%d\n", tc.count, tc.time_base.den);
+	}
+	//input of more than 8 bits is encoded in 10 bits, anything else in 8
+	const AVPixFmtDescriptor *in_desc = av_pix_fmt_desc_get(in_fmt);
+	AVPixelFormat enc_fmt = in_desc->comp[0].depth_minus1 + 1 > 8 ? AV_PIX_FMT_YUV420P10LE : AV_PIX_FMT_YUV420P;
+#if !CHROMA_420 && !(INTRA_ONLY && INTRA_MJPEG)
+	//planar 4:2:2 and 4:4:4 keep their chroma
+	if (in_fmt == AV_PIX_FMT_YUV422P || in_fmt == AV_PIX_FMT_YUV444P ||
+	    in_fmt == AV_PIX_FMT_YUV422P10LE || in_fmt == AV_PIX_FMT_YUV444P10LE)
+		enc_fmt = in_fmt;
+#endif
+#if INTRA_ONLY && INTRA_MJPEG
+	if (enc_fmt != AV_PIX_FMT_YUV420P) {
+		printf("MJPEG takes 8-bit input only\n");
+		return -1;
+	}
+#endif
+	if (in_stream) {
+		int pipe_size = stream_input_pipe_size(fp_in, avpicture_get_size(in_fmt, in_w, in_h));
+		if (pipe_size)
+			printf("Stream input: pipe buffer %d KB, reading until EOF\n", pipe_size / 1024);
+		else
+			printf("Stream input: reading until EOF\n");
+	}
+
+#if CHUNK_FARM
+	if (decoder || playlist || in_mosaic || in_y4m || in_stream || in_tc || in_fmt != AV_PIX_FMT_YUV420P) {
+		printf("The chunk farm takes raw YUV files only\n");
+		return -1;
+	}
+	fclose(fp_in);
+	{
+		ChunkJob params;
+		memset(&params, 0, sizeof(params));
+		params.codec_id = codec_id;
+		params.width = in_w;
+		params.height = in_h;
+		params.bit_rate = 400000;
+		params.fps = 25;
+		params.gop_size = 10;
+		params.max_b_frames = 1;
+		return run_chunk_farm(in_path, out_path, params, framenum);
+	}
+#endif
+
+	//the encoders get the picture without its black borders, cut out by the ingest
+	int enc_w = in_w, enc_h = in_h;
+	CropWindow crop_window = { 0, 0, in_w, in_h, in_w, in_h };
+#if AUTO_CROP
+	if (!fp_in || in_stream || in_packed || in_fmt != enc_fmt || in_desc->comp[0].depth_minus1 + 1 > 8) {
+		printf("Auto-crop: takes 8-bit planar YUV files in the encoders' format, the frame is encoded as it is\n");
+	} else {
+		int frames = in_tc ? 0 : (int)((int64_t)AUTO_CROP_SECONDS * time_base.den / time_base.num);
+		while (in_tc && timecode_pts(in_tc, frames) < (int64_t)AUTO_CROP_SECONDS * in_tc->time_base.den)
+			frames++;
+		CropDetect detect(in_w, in_h, AUTO_CROP_BLACK);
+		int scanned = crop_scan(fp_in, in_y4m != NULL, in_fmt, in_w, in_h, std::min(frames, framenum), detect);
+		if (scanned < 0) {
+			printf("Could not seek back in %s after the border scan\n", in_path);
+			return -1;
+		}
+		crop_window = crop_window_for(detect, in_w, in_h, AUTO_CROP_PAD);
+		enc_w = crop_window.out_width;
+		enc_h = crop_window.out_height;
+		if (detect.found())
+			printf("Auto-crop: %d frames scanned with %s, picture %dx%d at %d,%d, encoding %dx%d at %d,%d\n",
+			       scanned, detect.name(), detect.right() - detect.left(), detect.bottom() - detect.top(),
+			       detect.left(), detect.top(), enc_w, enc_h, crop_window.x, crop_window.y);
+		else
+			printf("Auto-crop: %d frames scanned, all black, encoding %dx%d\n", scanned, enc_w, enc_h);
+	}
+#endif
+
     pCodec = avcodec_find_encoder(codec_id);
     if (!pCodec) {
         printf("Codec not found\n");
         return -1;
     }
+
+    Placement placement;
+#if PLACEMENT
+    if (!placement.init(PLACEMENT_CPUS, PLACEMENT_NO_SMT))
+        return -1;
+    placement.report();
+    if (!placement.pin_process())
+        printf("Placement: could not set the CPU affinity\n");
+#endif
+    //one pool per placement group, each thread pinned to one CPU of it
+    std::vector<std::unique_ptr<TaskPool> > pools;
+    for (int g = 0; g < placement.groups(); g++) {
+        const std::vector<int> &cpus = placement.group_cpus(g);
+        std::function<void(int)> pin;
+        if (!cpus.empty())
+            pin = [&cpus](int index) { Placement::pin_thread(std::vector<int>(1, cpus[index])); };
+        int threads = cpus.empty() ? budget.threads(POOL_THREADS)
+                                   : std::min((int)cpus.size(), budget.threads((int)cpus.size()));
+        pools.push_back(std::unique_ptr<TaskPool>(new TaskPool(threads, pin)));
+    }
+    TaskPool &pool = *pools[0];
+
+#if INTRA_ONLY
+    //avcodec_open2() is not thread safe, so one after another
+#if INTRA_SCALE
+    const int intra_first = INTRA_POOL_MIN;
+#else
+    const int intra_first = INTRA_POOL_SIZE;
+#endif
+    AVCodecContext *intraCtx[INTRA_POOL_SIZE];
+    for (int k = 0; k < intra_first; k++) {
+        intraCtx[k] = open_intra_encoder(pCodec, enc_w, enc_h, time_base, enc_fmt);
+        if (!intraCtx[k]) {
+            printf("Could not open intra codec context %d\n", k);
+            return -1;
+        }
+    }
+    pCodecCtx = intraCtx[0];
+#else
     pCodecCtx = avcodec_alloc_context3(pCodec);
     if (!pCodecCtx) {
         printf("Could not allocate video codec context\n");
         return -1;
     }
     pCodecCtx->bit_rate = 400000;
-    pCodecCtx->width = in_w;
-    pCodecCtx->height = in_h;
-    pCodecCtx->time_base.num=1;
-	pCodecCtx->time_base.den=25;
+    pCodecCtx->width = enc_w;
+    pCodecCtx->height = enc_h;
+    pCodecCtx->time_base = time_base;
+    if (in_sar.num > 0)
+        pCodecCtx->sample_aspect_ratio = in_sar;
     pCodecCtx->gop_size = 10;
     pCodecCtx->max_b_frames = 1;
-    pCodecCtx->pix_fmt = AV_PIX_FMT_YUV420P;
+    pCodecCtx->pix_fmt = enc_fmt;
 
     if (codec_id == AV_CODEC_ID_H264)
         av_opt_set(pCodecCtx->priv_data, "preset", "slow", 0);
+#if LIVE_CONTROL
+    //x264 can only reconfigure VBV if it was enabled when the encoder was opened
+    pCodecCtx->rc_max_rate = pCodecCtx->bit_rate;
+    pCodecCtx->rc_buffer_size = pCodecCtx->bit_rate;
+    //an I frame requested through pict_type becomes an IDR
+    av_opt_set(pCodecCtx->priv_data, "forced-idr", "1", 0);
+#endif
+#if ARCHIVE_FFV1
+    //every frame a keyframe, so any frame of the archive can be restored alone
+    pCodecCtx->gop_size = 1;
+    pCodecCtx->max_b_frames = 0;
+    pCodecCtx->level = 3;
+    pCodecCtx->slices = ARCHIVE_SLICES;
+    pCodecCtx->thread_count = 0;
+    pCodecCtx->thread_type = FF_THREAD_SLICE;
+    av_opt_set(pCodecCtx->priv_data, "slicecrc", "1", 0);
+    av_opt_set_int(pCodecCtx, "coder", 1, 0);	// range coder
+    av_opt_set_int(pCodecCtx, "context", 1, 0);	// large context model
+    pCodecCtx->flags |= CODEC_FLAG_GLOBAL_HEADER;	// Matroska wants the configuration record up front
+#endif
+    //libavcodec's own threads count against the budget too
+    if (budget.enabled())
+        pCodecCtx->thread_count = budget.threads(0);
  
     if (avcodec_open2(pCodecCtx, pCodec, NULL) < 0) {
         printf("Could not open codec\n");
+        if (av_pix_fmt_desc_get(enc_fmt)->comp[0].depth_minus1 >= 8)
+            printf("10-bit H.264 needs libavcodec linked with a 10-bit libx264\n");
         return -1;
     }
+#endif
+
+#if ARCHIVE_FFV1 && ARCHIVE_VERIFY
+    //Decoder for the bit-exactness check, fed from the writing stage
+    AVCodecContext *pVerifyCtx = avcodec_alloc_context3(avcodec_find_decoder(AV_CODEC_ID_FFV1));
+    AVFrame *pVerifyFrame = av_frame_alloc();
+    if (!pVerifyCtx || !pVerifyFrame) {
+        printf("Could not allocate verification decoder\n");
+        return -1;
+    }
+    pVerifyCtx->width = pCodecCtx->width;
+    pVerifyCtx->height = pCodecCtx->height;
+    pVerifyCtx->pix_fmt = pCodecCtx->pix_fmt;
+    pVerifyCtx->thread_count = 0;
+    pVerifyCtx->thread_type = FF_THREAD_SLICE;	// frame threads would delay output
+    pVerifyCtx->extradata = (uint8_t *)av_mallocz(pCodecCtx->extradata_size + FF_INPUT_BUFFER_PADDING_SIZE);
+    memcpy(pVerifyCtx->extradata, pCodecCtx->extradata, pCodecCtx->extradata_size);
+    pVerifyCtx->extradata_size = pCodecCtx->extradata_size;
+    if (avcodec_open2(pVerifyCtx, pVerifyCtx->codec, NULL) < 0) {
+        printf("Could not open verification decoder\n");
+        return -1;
+    }
+    int verify_errors = 0;
+#endif
     
 	// Start writing to the first pframe
     pFrame = av_frame_alloc();
@@ -192,180 +949,527 @@ int main(int argc, char* argv[])
         return -1;
     }
 
-	//Input raw data
-	fp_in = fopen(filename_in, "rb");
-	if (!fp_in) {
-		printf("Could not open %s\n", filename_in);
+	//Output bitstream
+#if ARCHIVE_FFV1
+	AVFormatContext *archive = open_archive(out_path, pCodecCtx);
+	if (!archive) {
+		printf("Could not open %s\n", out_path);
 		return -1;
 	}
-	//Output bitstream
-	fp_out = fopen(filename_out, "wb");
+#else
+	fp_out = fopen(out_path, "wb");
 	if (!fp_out) {
-		printf("Could not open %s\n", filename_out);
+		printf("Could not open %s\n", out_path);
 		return -1;
 	}
+#endif
 
-	y_size = pCodecCtx->width * pCodecCtx->height;
    
-   /*
-    * Enums for holding status information
-    */
-   enum ExitFlag {RETURN, BREAK, NONE};
-   enum ReadFlag {STILL_READING, DONE_READING};
-   enum EncodeFlag {STILL_ENCODING, DONE_ENCODING};
-   ExitFlag exit_flag = NONE;
-   ReadFlag read_flag = STILL_READING;
-   EncodeFlag encode_flag = STILL_ENCODING;
-
-   /*
-    * Queues used for producing and consuming threads
-    */
-   queue<AVFrame*> encodeQ;
-   queue<AVPacket*> writeQ;
+   //encoder k runs in placement group k % groups, on frames from that group's node
+   const int groups = placement.groups();
+   std::vector<std::unique_ptr<FramePool> > framePools;
+   for (int g = 0; g < groups; g++)
+   {
+       framePools.push_back(std::unique_ptr<FramePool>(new FramePool(pCodecCtx->width, pCodecCtx->height,
+                                                                   pCodecCtx->pix_fmt, INGEST_ALIGN, placement.group_node(g),
+                                                                   FRAME_HUGEPAGES, FRAME_MLOCK)));
+       //fault every frame in now rather than mid-stream
+       if (!framePools[g]->reserve(READ_AHEAD)) {
+           printf("Could not allocate video frames\n");
+           return -1;
+       }
+#if FRAME_HUGEPAGES || FRAME_MLOCK
+       char backing[256];
+       framePools[g]->describe(backing, sizeof(backing));
+       printf("Frame pool %d: %s\n", g, backing);
+#endif
+   }
+   std::atomic<bool> failed(false);
+#if ARCHIVE_FFV1
+   queue<uint32_t> sumQ;	// source checksums, FFV1 emits one packet per frame in order
+   int archive_frames = 0;
+#endif
+#if LIVE_CONTROL
+   LiveControl control;
+   if (!control.start(CONTROL_FIFO))
+       return -1;
+#endif
 
 
 /*
  * Our parallelized section
  *
- * 	Each section within the pragma omp parallel sections
- * 	is given its own thread to perform the enclosed code.
- * 	Blocking queues are used to facilitate a producer
- * 	consumer style workflow so each thread is waiting to
- * 	perform their tasks as little as possible
+ * 	The pipeline is a chain of stages running as tasks on the
+ * 	work-stealing pool (see task_pool.h). A stage only holds a
+ * 	thread while it has work, so whichever stage is busy gets the
+ * 	cores, and the pool size does not depend on the stage count.
  *
- * 	exit_flag: used to emulate breaks and returns since
- * 		omp does not work with breaks and returns
+ * 	failed: set by any stage on error; the others then drain
+ * 		their input without doing work
  *
- * 	Reading thread: This thread will read in all available
- * 		data frames from the input file and push them
- * 		onto a blocking queue
+ * 	Reading stage: a source that reads one frame per call and
+ * 		hands it to an active encoding stage. At most READ_AHEAD
+ * 		frames are in flight, each encoded frame gives a token
+ * 		back. At the end it sends every active encoding stage
+ * 		a NULL frame. With INTRA_SCALE it also grows and shrinks
+ * 		the set of active encoding stages.
  *
- * 	Encoding thread: This thread will consume from the blocking
- * 		read queue and encode each frame of data that it gets.
- * 		Encoded data is then pushed onto the writing queue to
- * 		be written later
+ * 	Encoding stages: one per codec context, each strictly serial.
+ * 		A NULL frame flushes the context and is passed on to
+ * 		the writing stage as a NULL packet; intra contexts are
+ * 		freed then, whether retired early or at the end.
  *
- * 	Writing thread: This thread will consume from the writing queue
- * 		and will write each frame of encoded data to the final
- * 		output file
+ * 	Writing stage: writes packets to the output file and signals
+ * 		completion once every encoding stage has sent its NULL.
  *
  *
  */
-#pragma omp parallel sections
-   {
-	 /* READING THREAD */
-     #pragma omp section
-     {
-	   AVFrame *tempFrame;
-	   for (i = 0; i < framenum; i++) {
-	       //allocate new frame into which input will be read
-	       if(exit_flag == NONE){
-		   tempFrame = av_frame_alloc();
-		   if (!tempFrame) {
-		       printf("Could not allocate video frame\n");
-		       exit_flag = RETURN;
-		   }
-	       }
-	       if(exit_flag == NONE){
-		   tempFrame->format = pCodecCtx->pix_fmt;
-		   tempFrame->width  = pCodecCtx->width;
-		   tempFrame->height = pCodecCtx->height;
-
-		   ret = av_image_alloc(tempFrame->data, tempFrame->linesize, pCodecCtx->width, pCodecCtx->height, pCodecCtx->pix_fmt, 16);
-		   if (ret < 0) {
-		       printf("Could not allocate raw picture buffer\n");
-		       exit_flag = RETURN;
-		   }
-	       }
-	       if (exit_flag == NONE) {
-		   //Read raw YUV data from fp_in into pFrame->data
-		   if (fread(tempFrame->data[0], 1, y_size, fp_in) <= 0 ||      // Y
-		       fread(tempFrame->data[1], 1, y_size / 4, fp_in) <= 0 ||	// U
-		       fread(tempFrame->data[2], 1, y_size / 4, fp_in) <= 0) {	// V
-		       exit_flag = RETURN;
-		   }
-		   else if (feof(fp_in)) {
-		       exit_flag = BREAK;
-		   }
-
-		   if (exit_flag == NONE) {
-		       tempFrame->pts = i;
-		       encodeQ.push(tempFrame);
-		   }
-	       }
-	   }
-	   read_flag = DONE_READING; // finished with reading input
-     }   
-
-	 /* ENCODING THREAD */
-     #pragma omp section
-     {
-	   printf("Starting Encoding\n");
-
-	   AVFrame *tempEncodeFrame;
-	   AVPacket *tempPkt;
-	   while(read_flag != DONE_READING || !encodeQ.empty()){
-	       tempPkt = new AVPacket;
-	       av_init_packet(tempPkt);
-	       tempPkt->data = NULL;    // packet data will be allocated by the encoder
-	       tempPkt->size = 0;
-	       if (exit_flag == NONE) {
-		   tempEncodeFrame = encodeQ.pop();
-		   ret = avcodec_encode_video2(pCodecCtx, tempPkt, tempEncodeFrame, &got_output);
-
-		   if (ret < 0) {
-		       printf("Error encoding frame\n");
-		       exit_flag = BREAK;
-		   }
-		   if (got_output) {
-		       writeQ.push(tempPkt);
-		   }
-	       }
-	   }
-	   encode_flag = DONE_ENCODING; // finished encoding process
-     }
-
-	 /* WRITING THREAD */
-     #pragma omp section
-     {
-	   AVPacket *tempWritePkt;
-	   i = 0;
-	   while (encode_flag != DONE_ENCODING || !writeQ.empty()) {
-	       if (exit_flag == NONE) {
-		   tempWritePkt = writeQ.pop();
-		   printf("Succeed to encode frame: %5d\tsize:%5d\n", i++, tempWritePkt->size);
-		   fwrite(tempWritePkt->data, 1, tempWritePkt->size, fp_out);
-	       }
-	   }
-     }
+   Completion finished;
+   int written = 0;
+   std::atomic<int> running(0);	// encoding stages that have not sent their NULL
+#if INTRA_ONLY
+   //packets come back from the pool out of order, hold them until their pts is due
+   std::map<int64_t, AVPacket*> pending;
+   int64_t next_pts = in_tc ? in_tc->pts[0] : 0;
+   //each context numbers its own IDRs, so they are renumbered in output order
+   IdrRewriter idr;
+   idr_rewriter_init(&idr);
+   const bool renumber_idr = pCodecCtx->codec_id == AV_CODEC_ID_H264;
+#endif
 
+   /* WRITING STAGE */
+   auto write_packet = [&](AVPacket *tempWritePkt) {
+       printf("Succeed to encode frame: %5d\tsize:%5d\n", written++, tempWritePkt->size);
+#if ARCHIVE_FFV1
+       if (write_archive_packet(archive, pCodecCtx, tempWritePkt) < 0) {
+           printf("Error writing the archive\n");
+           failed = true;
+       }
+       uint32_t sum = sumQ.pop();
+       archive_frames++;
+#if ARCHIVE_VERIFY
+       int got_verify = 0;
+       if (avcodec_decode_video2(pVerifyCtx, pVerifyFrame, &got_verify, tempWritePkt) < 0 ||
+           !got_verify || frame_checksum(pVerifyFrame) != sum) {
+           printf("Archive verification failed at frame %5d\n", archive_frames);
+           verify_errors++;
+       }
+#endif
+#else
+       fwrite(tempWritePkt->data, 1, tempWritePkt->size, fp_out);
+#endif
+       av_free_packet(tempWritePkt);
+       delete tempWritePkt;
+   };
+   SerialStage<AVPacket*> writeStage(pool, [&](AVPacket *tempWritePkt) {
+       if (!tempWritePkt)
+           running--;
+#if INTRA_ONLY
+       else
+           pending[tempWritePkt->pts] = tempWritePkt;
+       //once all contexts are done, skip over frames that failed to encode
+       while (!pending.empty() &&
+              (pending.begin()->first == next_pts || running == 0)) {
+           next_pts = in_tc ? timecode_next(in_tc, pending.begin()->first) : pending.begin()->first + 1;
+           if (renumber_idr && idr_rewrite_packet(&idr, pending.begin()->second) < 0) {
+               printf("Could not renumber the IDR of frame %5d\n", written);
+               failed = true;
+           }
+           write_packet(pending.begin()->second);
+           pending.erase(pending.begin());
+       }
+#else
+       else
+           write_packet(tempWritePkt);
+#endif
+       if (running == 0)
+           finished.signal();
+   });
+
+   /* ENCODING STAGES */
+   SourceStage *readStage = NULL;
+   //one slot per context that can run at once: the stages never move while the
+   //conversion stages deliver into them, and a retired slot is reused by the next context
+#if INTRA_ONLY
+   const int encode_slots = INTRA_POOL_SIZE;
+#else
+   const int encode_slots = 1;
+#endif
+   std::vector<std::unique_ptr<SerialStage<AVFrame*> > > encodeStages(encode_slots);
+   std::vector<AVCodecContext*> encodeCtx(encode_slots, (AVCodecContext*)NULL);
+   std::vector<std::atomic<bool> > slotFree(encode_slots);	// retired and drained
+   std::vector<int> active;	// stages the reader hands frames to
+   std::atomic<long long> encode_ns(0);	// time spent in avcodec_encode_video2()
+   std::atomic<int> encode_calls(0);
+   //false if every slot is taken, the caller keeps ctx
+   auto add_encoder = [&](AVCodecContext *ctx) -> bool {
+       int k = 0;
+       while (k < encode_slots && encodeStages[k] && !slotFree[k])
+           k++;
+       if (k == encode_slots)
+           return false;
+       encodeCtx[k] = ctx;
+       slotFree[k] = false;
+       running++;
+       active.push_back(k);
+       if (encodeStages[k])
+           return true;	// frames queue behind the retired context's NULL
+       FramePool *frames = framePools[k % groups].get();
+       encodeStages[k].reset(new SerialStage<AVFrame*>(*pools[k % groups],
+           [&, k, frames](AVFrame *tempEncodeFrame) {
+           AVCodecContext *ctx = encodeCtx[k];
+           int got_output = 1;
+           //a frame is encoded once, a NULL frame until the context is drained
+           while (!failed && got_output) {
+               AVPacket *tempPkt = new AVPacket;
+               av_init_packet(tempPkt);
+               tempPkt->data = NULL;    // packet data will be allocated by the encoder
+               tempPkt->size = 0;
+               if (tempEncodeFrame) {
+#if LIVE_CONTROL
+                   control.apply(ctx, tempEncodeFrame);
+#endif
+#if ARCHIVE_FFV1
+                   sumQ.push(frame_checksum(tempEncodeFrame));
+#endif
+                   tempEncodeFrame->quality = ctx->global_quality;
+               }
+               std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+               long long cpu_start = CpuBudget::thread_cpu_ns();
+               if (avcodec_encode_video2(ctx, tempPkt, tempEncodeFrame, &got_output) < 0) {
+                   printf("Error encoding frame\n");
+                   failed = true;
+                   got_output = 0;
+               }
+               encode_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - start).count();
+               encode_calls++;
+               budget.add_encode_ns(CpuBudget::thread_cpu_ns() - cpu_start);
+               if (got_output)
+                   writeStage.push(tempPkt);
+               else
+                   delete tempPkt;
+               if (tempEncodeFrame)
+                   break;
+           }
+           if (tempEncodeFrame) {
+               //a decoded frame is reference counted, freeing it returns its buffer to the decoder
+               if (tempEncodeFrame->buf[0])
+                   av_frame_free(&tempEncodeFrame);
+               else
+                   frames->put(tempEncodeFrame);
+               readStage->release();
+           } else {
+#if INTRA_ONLY
+               avcodec_free_context(&encodeCtx[k]);
+#endif
+               slotFree[k] = true;
+               writeStage.push(NULL); // this context is done
+           }
+       }));
+       return true;
+   };
+#if INTRA_ONLY
+   for (int k = 0; k < intra_first; k++)
+       add_encoder(intraCtx[k]);
+#else
+   add_encoder(pCodecCtx);
+#endif
+
+   /* CONVERSION STAGE */
+   //the reader fills the frames itself if the input needs no conversion, or only a kernel one;
+   //decoded frames in the encoders' format need neither
+   std::unique_ptr<FrameReader> ingest(in_fmt == enc_fmt && !decoder && !in_packed && !in_mosaic ?
+                                       ingest_for<INGEST_ALIGN>(in_fmt, in_w, in_h) : NULL);
+   if (ingest) {
+       printf("Ingest: %s %s row copy\n", ingest->name(), av_get_pix_fmt_name(in_fmt));
+       if ((enc_w != in_w || enc_h != in_h) && !ingest->crop(crop_window)) {
+           printf("Could not crop the input\n");
+           return -1;
+       }
+   }
+#if INGEST_KERNELS
+   else if (!decoder && !in_packed && !in_mosaic && KernelIngest<INGEST_ALIGN>::supports(in_fmt) && pCodecCtx->pix_fmt == AV_PIX_FMT_YUV420P) {
+       ingest.reset(new KernelIngest<INGEST_ALIGN>(in_fmt, in_w, in_h));
+       printf("Convert: %s to yuv420p with %s kernels\n", av_get_pix_fmt_name(in_fmt), ingest->name());
    }
+#endif
+#if PACKED_INPUT
+   //packed frames are decompressed on the pool straight into the encoders' frames
+   std::unique_ptr<UnpackStage> unpack;
+   if (in_packed) {
+       if (in_fmt != enc_fmt) {
+           printf("Packed input must be in the encoders' format, %s\n", av_get_pix_fmt_name(enc_fmt));
+           return -1;
+       }
+       unpack.reset(new UnpackStage(fp_in, packed, packed_offsets,
+                                    [&](AVFrame *frame, int k) { encodeStages[k]->push(frame); }));
+       printf("Unpack: %s frames on %d threads\n", av_get_pix_fmt_name(in_fmt), threads_total(pools));
+   }
+#endif
+   //mosaic inputs are composited on the pool straight into the encoders' frames
+   std::unique_ptr<MosaicStage> mosaic;
+   if (in_mosaic)
+       mosaic.reset(new MosaicStage(mosaic_layout, MOSAIC_QUEUE, MOSAIC_WAIT_MS, MOSAIC_START_MS,
+                                    [&](AVFrame *frame, int k) { encodeStages[k]->push(frame); }));
+   std::unique_ptr<ConvertStage> convert;
+   int src_bytes = 0;
+   if (!ingest && !in_packed && !mosaic && (!decoder || in_fmt != enc_fmt)) {
+       int bands = CONVERT_BANDS ? CONVERT_BANDS : pool.size();
+       convert.reset(new ConvertStage(in_fmt, pCodecCtx->pix_fmt, in_w, in_h, bands, placement.group_node(0),
+                                      [&](AVFrame *frame, int k) { encodeStages[k]->push(frame); }));
+       if (!convert->init()) {
+           printf("Could not convert from %s\n", av_get_pix_fmt_name(in_fmt));
+           return -1;
+       }
+       src_bytes = convert->source_bytes();
+       printf("Convert: %s to %s in %d bands\n", av_get_pix_fmt_name(in_fmt),
+              av_get_pix_fmt_name(pCodecCtx->pix_fmt), convert->bands());
+   }
+   //hand a frame, or NULL to flush, to encoding stage k behind the frames still converting
+   auto send = [&](int k, AVFrame *frame) {
+       if (convert)
+           convert->push(*pools[k % groups], NULL, frame, k);
+#if PACKED_INPUT
+       else if (unpack)
+           unpack->pass(frame, k);
+#endif
+       else if (mosaic)
+           mosaic->pass(frame, k);
+       else
+           encodeStages[k]->push(frame);
+   };
 
-   if (exit_flag == RETURN) { return -1; }
+#if INTRA_ONLY && INTRA_SCALE
+   /*
+    * Called by the reader every INTRA_SCALE_INTERVAL frames.
+    *
+    * 	More than one frame waiting per active context means the
+    * 	encoders are behind: open another context, unless there are
+    * 	no more threads to run it or the writer is the one behind.
+    * 	No backlog and contexts busy less than half the time means
+    * 	the reader is behind: retire the newest context, which
+    * 	flushes and frees it. So does the CPU budget having held
+    * 	the reader since the last call, and then none is opened.
+    */
+   const int intra_max = std::min(INTRA_POOL_SIZE, threads_total(pools));
+   std::chrono::steady_clock::time_point scale_start = std::chrono::steady_clock::now();
+   int scale_holds = 0;
+   auto rescale = [&]() {
+       std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+       double wall_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(now - scale_start).count();
+       double busy_ns = (double)encode_ns.exchange(0);
+       int calls = encode_calls.exchange(0);
+       scale_start = now;
+       int encodeQ = 0;
+       for (size_t k = 0; k < active.size(); k++)
+           encodeQ += encodeStages[active[k]]->size();
+       int writeQ = writeStage.size();
+       int n = (int)active.size();
+       double busy = wall_ns > 0 ? busy_ns / (wall_ns * n) : 0;
+       double ms_per_frame = calls ? busy_ns / 1e6 / calls : 0;
+       bool over = budget.holds() != scale_holds;
+       scale_holds = budget.holds();
+       if (!over && encodeQ > n && writeQ <= READ_AHEAD / 2 && n < intra_max) {
+           AVCodecContext *ctx = open_intra_encoder(pCodec, enc_w, enc_h, time_base, enc_fmt);
+           if (!ctx)
+               return;	// keep going with what we have
+           if (!add_encoder(ctx)) {
+               //the retired contexts are still draining
+               avcodec_free_context(&ctx);
+               return;
+           }
+       } else if ((over || (encodeQ <= n && busy < 0.5)) && n > INTRA_POOL_MIN) {
+           int k = active.back();
+           active.pop_back();
+           send(k, NULL);
+       } else {
+           return;
+       }
+       printf("Scale: %d -> %d encoders (encodeQ %d, writeQ %d, %.1f ms/frame, %.0f%% busy%s)\n",
+              n, (int)active.size(), encodeQ, writeQ, ms_per_frame, busy * 100, over ? ", over the CPU budget" : "");
+   };
+#endif
 
-    //Init packet for flush encoder to flush data to
-    av_init_packet(&pkt);
-    pkt.data = NULL;    
-    pkt.size = 0;
+   /* READING STAGE */
+   int read_frames = 0;
+   auto frame_pts = [&](int index) -> int64_t { return in_tc ? timecode_pts(in_tc, index) : index; };
+   SourceStage reader(pool, READ_AHEAD, [&]() -> bool {
+#if INTRA_ONLY && INTRA_SCALE
+       if (read_frames > 0 && read_frames % INTRA_SCALE_INTERVAL == 0)
+           rescale();
+#endif
+       AVFrame *tempFrame = NULL;
+       int target = active[read_frames % active.size()];
+       FramePool *frames = framePools[target % groups].get();
+#if PACKED_INPUT
+       if (unpack && unpack->failed())
+           failed = true;
+#endif
+       bool more = !failed && read_frames < framenum;
+       AVFrame *decoded = NULL;
+       if (more && decoder) {
+           //the end of the decoded frames is the end of the input
+           decoded = decoder->next();
+           if (decoded && (decoded->width != in_w || decoded->height != in_h || decoded->format != in_fmt)) {
+               printf("The input changes size or format mid-stream\n");
+               av_frame_free(&decoded);
+               failed = true;
+           }
+           if (!decoded && decoder->failed())
+               failed = true;
+           more = decoded != NULL;
+           if (decoded && !convert) {
+               //in the encoders' format already: handed on as it is
+               tempFrame = decoded;
+               decoded = NULL;
+               more = false;
+           }
+       }
+       if (more) {
+           //take a frame of the target encoder's pool to read the input into
+           tempFrame = frames->get();
+           if (!tempFrame) {
+               printf("Could not allocate video frame\n");
+               failed = true;
+           }
+       }
+       AVFrame *srcFrame = NULL;
+       if (tempFrame && more) {
+           //Read raw YUV data from fp_in into tempFrame->data, a short read ends the input.
+           //y4m frames start with a FRAME line, its absence is the end of the input
+           FILE *src = fp_in;
+           if (playlist) {
+               //the current clip, or the next one at the end of its range
+               src = playlist->next();
+               if (!src && playlist->failed())
+                   failed = true;
+           }
+           bool ok = decoded || mosaic || (src && (!in_y4m || y4m_read_frame_header(src) == 0));
+           if (ok && convert) {
+               //other formats go into a source buffer, converted into tempFrame on the way
+               srcFrame = convert->source();
+               if (!srcFrame) {
+                   printf("Could not allocate video frame\n");
+                   failed = true;
+               }
+               if (decoded) {
+                   ok = srcFrame != NULL;
+                   if (ok)
+                       av_image_copy(srcFrame->data, srcFrame->linesize, (const uint8_t **)decoded->data,
+                                     decoded->linesize, in_fmt, in_w, in_h);
+               } else {
+                   ok = srcFrame && fread(srcFrame->data[0], 1, src_bytes, src) == (size_t)src_bytes;
+               }
+           }
+#if PACKED_INPUT
+           else if (ok && unpack) {
+               //the frame is handed on once decompressed
+               tempFrame->pts = frame_pts(read_frames);
+               ok = unpack->read(*pools[target % groups], tempFrame, target);
+           }
+#endif
+           else if (ok && mosaic) {
+               //the frame is handed on once composited, the mosaic ends with its last input
+               tempFrame->pts = frame_pts(read_frames);
+               ok = mosaic->compose(*pools[target % groups], tempFrame, target);
+           }
+           else if (ok) {
+               ok = ingest->read(src, tempFrame);
+           }
+           if (ok && convert) {
+               tempFrame->pts = frame_pts(read_frames);
+               if (!convert->push(*pools[target % groups], srcFrame, tempFrame, target)) {
+                   printf("Could not allocate conversion contexts\n");
+                   failed = true;
+                   ok = false;
+               }
+           }
+           if (!ok) {
+               if (srcFrame)
+                   convert->put_source(srcFrame);
+               frames->put(tempFrame);
+               tempFrame = NULL;
+           }
+       }
+       av_frame_free(&decoded);	// copied, or not needed
+       if (!tempFrame) {
+           //a NULL frame tells each encoding stage to flush and stop
+           for (size_t k = 0; k < active.size(); k++)
+               send(active[k], NULL);
+           return false;
+       }
+       if (!convert && !in_packed && !mosaic) {
+           tempFrame->pts = frame_pts(read_frames);
+           encodeStages[target]->push(tempFrame);
+       }
+       read_frames++;
+       return true;
+   });
+   readStage = &reader;
 
-    //Flush Encoder
-    for (int got_output = 1; got_output; i++) {
-        ret = avcodec_encode_video2(pCodecCtx, &pkt, NULL, &got_output);
-        if (ret < 0) {
-            printf("Error encoding frame\n");
-            return -1;
-        }
-        if (got_output) {
-            printf("Flush Encoder: Succeed to encode 1 frame!\tsize:%5d\n", pkt.size);
-            fwrite(pkt.data, 1, pkt.size, fp_out);
-            av_free_packet(&pkt);
-        }
+   printf("Starting Encoding on %d threads\n", threads_total(pools));
+   if (playlist)
+       playlist->start(pool);
+   //with a CPU budget the governor holds the reader, and so the encoders, until CPU use is back under it
+   budget.start([&reader](bool held) { reader.hold(held); });
+   reader.start();
+   finished.wait();
+   budget.stop();
+   for (int g = 0; g < groups; g++)
+       pools[g]->wait_idle();
+
+#if PLACEMENT
+   for (int g = 0; g < groups; g++)
+       if (!framePools[g]->bound())
+           printf("Placement: node %d refused the frame binding, frames stay where they were first touched\n",
+                  placement.group_node(g));
+#endif
+
+#if LIVE_CONTROL
+   control.stop();
+#endif
+   if (mosaic)
+       mosaic->report();
+   if (ingest && ingest->clipped())
+       printf("Ingest: %d frames had samples beyond %d bits, clipped\n",
+              ingest->clipped(), in_desc->comp[0].depth_minus1 + 1);
+   if (budget.enabled())
+       budget.report(written);
+
+   if (failed) { return -1; }
+
+#if ARCHIVE_FFV1
+    double in_bytes = (double)avpicture_get_size(pCodecCtx->pix_fmt, pCodecCtx->width, pCodecCtx->height) * archive_frames;
+    int64_t archive_bytes = close_archive(archive);
+    if (archive_bytes < 0) {
+        printf("Error writing the archive\n");
+        return -1;
     }
+    printf("Archive: %.2fx smaller than the raw input\n", in_bytes / archive_bytes);
+#if ARCHIVE_VERIFY
+    avcodec_free_context(&pVerifyCtx);
+    av_frame_free(&pVerifyFrame);
+    if (verify_errors) {
+        printf("Archive verification failed for %d frames\n", verify_errors);
+        return -1;
+    }
+    printf("Archive verified bit-exact\n");
+#endif
+#endif
 
 	// Teardown
+    if (fp_in && fp_in != stdin)
+        fclose(fp_in);
+    if (in_tc)
+        timecode_free(&tc);
+#if !ARCHIVE_FFV1
     fclose(fp_out);
+#endif
+#if !INTRA_ONLY
     avcodec_close(pCodecCtx);
     av_free(pCodecCtx);
+#endif
     av_freep(&pFrame->data[0]);
 
 	return 0;
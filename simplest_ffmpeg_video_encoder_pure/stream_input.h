@@ -0,0 +1,97 @@
+/**
+ * Piped input for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers.
+ *
+ * The input may be "-" for stdin or a named pipe as well as a file,
+ * so frames can come straight from another process:
+ *
+ * 	ffmpeg -i cam.sdp -f yuv4mpegpipe - | encoder - out.h264
+ * 	mkfifo /tmp/cap.yuv; capture > /tmp/cap.yuv & encoder /tmp/cap.yuv
+ *
+ * A stream has no length, so the reader runs until EOF. Memory stays
+ * constant however long it runs: every frame is read into a buffer of
+ * the frame pool, which holds no more than READ_AHEAD frames, and
+ * nothing else grows with the frame count.
+ *
+ * On Linux the pipe is enlarged with F_SETPIPE_SZ to hold a whole
+ * frame (as far as /proc/sys/fs/pipe-max-size allows), so the writer
+ * can hand over a frame per wakeup instead of one 64 KB chunk at a
+ * time. splice() and vmsplice() do not help here: they move pages
+ * between pipes and files or from user memory into a pipe, never from
+ * a pipe into user memory, so read() into the pooled frame is already
+ * the single copy the data needs.
+ */
+
+#ifndef STREAM_INPUT_H
+#define STREAM_INPUT_H
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+/*
+ * Open path for reading, "-" for stdin.
+ * *stream is set if it is not a regular file, i.e. has no known length.
+ */
+static FILE *stream_input_open(const char *path, bool *stream)
+{
+	FILE *fp;
+	if (!strcmp(path, "-")) {
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+		fp = stdin;
+	} else {
+		fp = fopen(path, "rb");
+	}
+	*stream = false;
+	if (!fp)
+		return NULL;
+#ifdef _WIN32
+	*stream = fp == stdin;
+#else
+	struct stat st;
+	*stream = fstat(fileno(fp), &st) < 0 || !S_ISREG(st.st_mode);
+#endif
+	return fp;
+}
+
+/*
+ * Grow the pipe behind fp to frame_bytes, returns the new size or 0
+ * if fp is no pipe or the size could not be changed.
+ */
+static int stream_input_pipe_size(FILE *fp, int frame_bytes)
+{
+#if defined(__linux__) && defined(F_SETPIPE_SZ)
+	int fd = fileno(fp);
+	int size = frame_bytes;
+	FILE *max = fopen("/proc/sys/fs/pipe-max-size", "r");
+	if (max) {
+		int limit;
+		if (fscanf(max, "%d", &limit) == 1 && limit < size)
+			size = limit;
+		fclose(max);
+	}
+	if (fcntl(fd, F_GETPIPE_SZ) < 0)
+		return 0;
+	if (fcntl(fd, F_SETPIPE_SZ, size) < 0)
+		return 0;
+	return fcntl(fd, F_GETPIPE_SZ);
+#else
+	(void)fp;
+	(void)frame_bytes;
+	return 0;
+#endif
+}
+
+#endif
@@ -0,0 +1,408 @@
+/**
+ * Work-stealing task pool for Simplest FFmpeg Video Encoder Pure
+ *
+ * TaskPool runs short tasks on a fixed number of threads, chosen
+ * independently of how many pipeline stages there are. Every thread
+ * owns a deque: it pushes and pops its own work at the back, and
+ * when that runs dry it steals from the front of the others.
+ *
+ * On top of the pool:
+ *
+ * 	SerialStage<T>	a stage that processes pushed items one at a
+ * 			time in push order, e.g. one codec context. It
+ * 			only occupies a thread while it has items.
+ *
+ * 	SourceStage	a stage that produces items until its function
+ * 			returns false, at most `tokens` ahead of their
+ * 			consumers, which hand tokens back with release().
+ *
+ * 	TaskGraph	one-shot tasks with dependencies.
+ *
+ * 	Completion	lets a thread outside the pool wait for a signal.
+ *
+ * None of these block a pool thread, so a stage that has nothing to
+ * do leaves its core to the stages that do.
+ */
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class TaskPool
+{
+private:
+    struct Worker
+    {
+        std::mutex                         mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker> > d_workers;
+    std::vector<std::thread>              d_threads;
+    std::mutex                            d_idle_mutex;
+    std::condition_variable               d_idle;
+    std::condition_variable               d_quiet;
+    int                                   d_pending;	// queued, not yet taken
+    int                                   d_active;	// taken, still running
+    bool                                  d_stop;
+    std::atomic<unsigned>                 d_next;
+
+    //which worker of which pool the calling thread is
+    static TaskPool *&current_pool() { static thread_local TaskPool *pool = NULL; return pool; }
+    static int &current_index() { static thread_local int index = -1; return index; }
+
+    bool take(int self, std::function<void()> &task) {
+        int n = (int)d_workers.size();
+        {
+            Worker &own = *d_workers[self];
+            std::unique_lock<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (int k = 1; k < n; k++) {
+            Worker &victim = *d_workers[(self + k) % n];
+            std::unique_lock<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(int self, std::function<void(int)> on_start) {
+        current_pool() = this;
+        current_index() = self;
+        if (on_start)
+            on_start(self);
+        std::function<void()> task;
+        while (true) {
+            if (take(self, task)) {
+                {
+                    std::unique_lock<std::mutex> lock(d_idle_mutex);
+                    d_pending--;
+                    d_active++;
+                }
+                task();
+                task = nullptr;
+                std::unique_lock<std::mutex> lock(d_idle_mutex);
+                if (--d_active == 0 && d_pending == 0)
+                    d_quiet.notify_all();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(d_idle_mutex);
+            d_idle.wait(lock, [=]{ return this->d_stop || this->d_pending > 0; });
+            if (d_stop && d_pending == 0)
+                return;
+        }
+    }
+
+public:
+    /*
+     * threads: 0 for one per core
+     * on_start: called first thing on every pool thread with its
+     * index, e.g. to pin it to a CPU
+     */
+    explicit TaskPool(int threads, std::function<void(int)> on_start = std::function<void(int)>())
+        : d_pending(0), d_active(0), d_stop(false), d_next(0) {
+        if (threads <= 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads <= 0)
+            threads = 1;
+        for (int k = 0; k < threads; k++)
+            d_workers.push_back(std::unique_ptr<Worker>(new Worker));
+        for (int k = 0; k < threads; k++)
+            d_threads.push_back(std::thread(&TaskPool::run, this, k, on_start));
+    }
+
+    //runs what is still queued, then joins
+    ~TaskPool() {
+        {
+            std::unique_lock<std::mutex> lock(d_idle_mutex);
+            d_stop = true;
+        }
+        d_idle.notify_all();
+        for (size_t k = 0; k < d_threads.size(); k++)
+            d_threads[k].join();
+    }
+
+    int size() const { return (int)d_workers.size(); }
+
+    /*
+     * Wait until no task is queued or running. Stages must not be
+     * destroyed before this, a finished stage may still be unwinding
+     * its last task.
+     */
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(d_idle_mutex);
+        d_quiet.wait(lock, [=]{ return this->d_pending == 0 && this->d_active == 0; });
+    }
+
+    /*
+     * Queue a task. From a pool thread it goes to that thread's own
+     * deque, which keeps a stage's follow-up work cache-warm; from
+     * outside, the deques are filled round-robin.
+     */
+    void submit(std::function<void()> fn) {
+        int w = current_pool() == this ? current_index()
+                                        : (int)(d_next++ % d_workers.size());
+        expect();
+        {
+            Worker &worker = *d_workers[w];
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(fn));
+        }
+        d_idle.notify_one();
+    }
+
+    /*
+     * Queue a task behind everything the calling thread already has
+     * queued, so a long-running job that requeues itself this way
+     * takes turns with the others instead of running again at once.
+     */
+    void defer(std::function<void()> fn) {
+        if (current_pool() != this) {
+            submit(std::move(fn));
+            return;
+        }
+        expect();
+        {
+            Worker &worker = *d_workers[current_index()];
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.tasks.push_front(std::move(fn));
+        }
+        d_idle.notify_one();
+    }
+
+private:
+    //count a task before it is queued: once queued it can be stolen and finished at once
+    void expect() {
+        std::unique_lock<std::mutex> lock(d_idle_mutex);
+        d_pending++;
+    }
+};
+
+class Completion
+{
+private:
+    std::mutex              d_mutex;
+    std::condition_variable d_condition;
+    bool                    d_done;
+public:
+    Completion(): d_done(false) {}
+    void signal() {
+        //notify under the lock, the waiter may destroy us as soon as it wakes
+        std::unique_lock<std::mutex> lock(this->d_mutex);
+        d_done = true;
+        this->d_condition.notify_all();
+    }
+    void wait() {
+        std::unique_lock<std::mutex> lock(this->d_mutex);
+        this->d_condition.wait(lock, [=]{ return this->d_done; });
+    }
+};
+
+/*
+ * Processes items one at a time, in push order. Only one task of the
+ * stage is ever queued or running; it handles a few items and then
+ * requeues itself so other stages get a turn on the thread.
+ */
+template <typename T>
+class SerialStage
+{
+private:
+    TaskPool              &d_pool;
+    std::function<void(T)> d_fn;
+    std::mutex             d_mutex;
+    std::deque<T>          d_items;
+    bool                   d_scheduled;
+
+    void drain() {
+        for (int n = 0; n < 8; n++) {
+            T item;
+            {
+                std::unique_lock<std::mutex> lock(this->d_mutex);
+                if (d_items.empty()) {
+                    d_scheduled = false;
+                    return;
+                }
+                item = d_items.front();
+                d_items.pop_front();
+            }
+            d_fn(item);
+        }
+        //behind the thread's other work, or it would be popped straight back
+        d_pool.defer([this]{ this->drain(); });
+    }
+
+public:
+    SerialStage(TaskPool &pool, std::function<void(T)> fn)
+        : d_pool(pool), d_fn(fn), d_scheduled(false) {}
+
+    void push(T item) {
+        bool kick;
+        {
+            std::unique_lock<std::mutex> lock(this->d_mutex);
+            d_items.push_back(item);
+            kick = !d_scheduled;
+            d_scheduled = true;
+        }
+        if (kick)
+            d_pool.submit([this]{ this->drain(); });
+    }
+
+    int size() {
+        std::unique_lock<std::mutex> lock(this->d_mutex);
+        return (int)d_items.size();
+    }
+};
+
+/*
+ * Calls fn until it returns false. Each call takes a token; when none
+ * are left the stage parks without holding a thread and resumes on
+ * the next release().
+ */
+class SourceStage
+{
+private:
+    TaskPool             &d_pool;
+    std::function<bool()> d_fn;
+    std::mutex            d_mutex;
+    int                   d_tokens;
+    bool                  d_scheduled;
+    bool                  d_done;
+    bool                  d_held;
+
+    void step() {
+        for (int n = 0; n < 8; n++) {
+            {
+                std::unique_lock<std::mutex> lock(this->d_mutex);
+                if (d_done || d_tokens == 0 || d_held) {
+                    d_scheduled = false;
+                    return;
+                }
+                d_tokens--;
+            }
+            if (!d_fn()) {
+                std::unique_lock<std::mutex> lock(this->d_mutex);
+                d_done = true;
+                d_scheduled = false;
+                return;
+            }
+        }
+        d_pool.submit([this]{ this->step(); });
+    }
+
+public:
+    SourceStage(TaskPool &pool, int tokens, std::function<bool()> fn)
+        : d_pool(pool), d_fn(fn), d_tokens(tokens), d_scheduled(false), d_done(false), d_held(false) {}
+
+    void start() {
+        {
+            std::unique_lock<std::mutex> lock(this->d_mutex);
+            d_scheduled = true;
+        }
+        d_pool.submit([this]{ this->step(); });
+    }
+
+    void release() {
+        bool kick;
+        {
+            std::unique_lock<std::mutex> lock(this->d_mutex);
+            d_tokens++;
+            kick = !d_scheduled && !d_done;
+            if (kick)
+                d_scheduled = true;
+        }
+        if (kick)
+            d_pool.submit([this]{ this->step(); });
+    }
+
+    //take no steps while held, tokens or not; for a thread outside the pool
+    void hold(bool held) {
+        bool kick;
+        {
+            std::unique_lock<std::mutex> lock(this->d_mutex);
+            d_held = held;
+            kick = !held && !d_scheduled && !d_done && d_tokens > 0;
+            if (kick)
+                d_scheduled = true;
+        }
+        if (kick)
+            d_pool.submit([this]{ this->step(); });
+    }
+};
+
+/*
+ * One-shot tasks with dependencies. add() returns an id that later
+ * tasks can depend on; run() executes the graph on a pool and returns
+ * when every task has finished. Call run() from outside the pool.
+ */
+class TaskGraph
+{
+private:
+    struct Node
+    {
+        std::function<void()> fn;
+        std::vector<int>      next;
+        std::atomic<int>      deps;
+    };
+
+    std::vector<std::unique_ptr<Node> > d_nodes;
+    std::mutex                          d_mutex;
+    std::condition_variable             d_condition;
+    int                                 d_left;
+
+    void launch(TaskPool &pool, int id) {
+        pool.submit([this, &pool, id]{
+            Node &node = *this->d_nodes[id];
+            node.fn();
+            for (size_t k = 0; k < node.next.size(); k++)
+                if (--this->d_nodes[node.next[k]]->deps == 0)
+                    this->launch(pool, node.next[k]);
+            std::unique_lock<std::mutex> lock(this->d_mutex);
+            if (--this->d_left == 0)
+                this->d_condition.notify_all();	// under the lock, see Completion
+        });
+    }
+
+public:
+    TaskGraph(): d_left(0) {}
+
+    int add(std::function<void()> fn, const std::vector<int> &deps = std::vector<int>()) {
+        int id = (int)d_nodes.size();
+        d_nodes.push_back(std::unique_ptr<Node>(new Node));
+        d_nodes[id]->fn = fn;
+        d_nodes[id]->deps = (int)deps.size();
+        for (size_t k = 0; k < deps.size(); k++)
+            d_nodes[deps[k]]->next.push_back(id);
+        return id;
+    }
+
+    void run(TaskPool &pool) {
+        d_left = (int)d_nodes.size();
+        //collect the roots first, finished tasks start modifying deps
+        std::vector<int> roots;
+        for (size_t k = 0; k < d_nodes.size(); k++)
+            if (d_nodes[k]->deps == 0)
+                roots.push_back((int)k);
+        for (size_t k = 0; k < roots.size(); k++)
+            launch(pool, roots[k]);
+        std::unique_lock<std::mutex> lock(d_mutex);
+        d_condition.wait(lock, [=]{ return this->d_left == 0; });
+    }
+};
+
+#endif
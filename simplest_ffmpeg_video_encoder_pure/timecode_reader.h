@@ -0,0 +1,151 @@
+/**
+ * Timecode sidecar input
+ *
+ * Included after the FFmpeg headers. The same header is kept in both
+ * encoder projects.
+ *
+ * Variable frame rate input, like screen capture or footage with
+ * repeated frames dropped, has no frame rate to time it by. A
+ * timecode format v2 file, as mkvextract writes and mkvmerge reads,
+ * gives the presentation time of every frame in milliseconds, one
+ * line per frame:
+ *
+ * 	# timecode format v2
+ * 	0
+ * 	33.367
+ * 	66.733
+ * 	150.15
+ *
+ * The time base is the coarsest of 1/1000, 1/90000 and 1/1000000 s
+ * that holds every time exactly, so whole milliseconds stay in 1/1000
+ * and 90 kHz clocks in 1/90000; anything finer is rounded to
+ * microseconds. Frames beyond the last line go on at the duration of
+ * the last frame.
+ */
+
+#ifndef TIMECODE_READER_H
+#define TIMECODE_READER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef struct TimecodeInfo {
+	int64_t *pts;			// of every frame listed, in time_base
+	int count;
+	AVRational time_base;
+} TimecodeInfo;
+
+//read the timecodes of count frames from fp, NULL if one is bad or out of order
+static double *timecode_read_times(FILE *fp, int *count)
+{
+	char line[256];
+	double *ms = NULL;
+	int size = 0;
+	*count = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		char *p = line + strspn(line, " \t");
+		double t;
+		if (*p == '#' || *p == '\r' || *p == '\n' || !*p)
+			continue;
+		if (sscanf(p, "%lf", &t) != 1 || (*count && t <= ms[*count - 1])) {
+			free(ms);
+			return NULL;
+		}
+		if (*count == size) {
+			double *grown = (double *)realloc(ms, (size ? 2 * size : 1024) * sizeof(double));
+			if (!grown) {
+				free(ms);
+				return NULL;
+			}
+			ms = grown;
+			size = size ? 2 * size : 1024;
+		}
+		ms[(*count)++] = t;
+	}
+	return ms;
+}
+
+/*
+ * Read the timecode v2 file at path into *tc, free it with
+ * timecode_free(). Returns 0 on success, -1 if it cannot be opened or
+ * is no timecode v2 file with increasing times.
+ */
+static int timecode_read(const char *path, TimecodeInfo *tc)
+{
+	static const int dens[] = { 1000, 90000, 1000000 };
+	char line[256];
+	double *ms = NULL;
+	int count = 0;
+	FILE *fp = fopen(path, "r");
+	memset(tc, 0, sizeof(*tc));
+	if (!fp)
+		return -1;
+	if (fgets(line, sizeof(line), fp) && !strncmp(line, "# timecode format v2", 20))
+		ms = timecode_read_times(fp, &count);
+	fclose(fp);
+	if (!ms || !count) {
+		free(ms);
+		return -1;
+	}
+	int d = 0;
+	for (; d < 2; d++) {
+		int k = 0;
+		while (k < count && fabs(ms[k] * dens[d] / 1000 - floor(ms[k] * dens[d] / 1000 + 0.5)) < 0.01)
+			k++;
+		if (k == count)
+			break;
+	}
+	tc->time_base.num = 1;
+	tc->time_base.den = dens[d];
+	tc->pts = (int64_t *)malloc(count * sizeof(int64_t));
+	if (!tc->pts) {
+		free(ms);
+		return -1;
+	}
+	for (int k = 0; k < count; k++)
+		tc->pts[k] = (int64_t)floor(ms[k] * dens[d] / 1000 + 0.5);
+	tc->count = count;
+	free(ms);
+	return 0;
+}
+
+static void timecode_free(TimecodeInfo *tc)
+{
+	free(tc->pts);
+	tc->pts = NULL;
+	tc->count = 0;
+}
+
+//duration of the last frame listed, 40 ms if there is only one
+static int64_t timecode_last_duration(const TimecodeInfo *tc)
+{
+	if (tc->count < 2)
+		return tc->time_base.den / 25;
+	return tc->pts[tc->count - 1] - tc->pts[tc->count - 2];
+}
+
+//pts of frame index
+static int64_t timecode_pts(const TimecodeInfo *tc, int index)
+{
+	if (index < tc->count)
+		return tc->pts[index];
+	return tc->pts[tc->count - 1] + (index - tc->count + 1) * timecode_last_duration(tc);
+}
+
+//pts of the frame after the one at pts
+static int64_t timecode_next(const TimecodeInfo *tc, int64_t pts)
+{
+	int lo = 0, hi = tc->count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (tc->pts[mid] <= pts)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < tc->count ? tc->pts[lo] : pts + timecode_last_duration(tc);
+}
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * CPU topology and thread placement for Simplest FFmpeg Video Encoder Pure
+ *
+ * Included by simplest_ffmpeg_video_encoder_pure.cpp after the
+ * FFmpeg headers. Linux only, elsewhere Placement keeps everything
+ * unpinned in a single group.
+ *
+ * The topology is read from sysfs:
+ *
+ * 	/sys/devices/system/cpu/online			online CPUs
+ * 	/sys/devices/system/cpu/cpuN/topology/		package, core and
+ * 							SMT siblings
+ * 	/sys/devices/system/node/nodeN/cpulist		CPUs of a NUMA node
+ *
+ * Placement selects CPUs from it (a CPU list and/or one thread per
+ * physical core) and splits the selection into one group per NUMA
+ * node. The caller runs one task pool per group, pins every pool
+ * thread to one CPU of its group, and allocates the frames a group
+ * consumes on that group's node (see frame_pool.h).
+ */
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Parse a kernel CPU list such as "0-3,8,10-11" into cpus.
+ */
+static bool parse_cpu_list(const char *list, std::vector<int> &cpus)
+{
+	cpus.clear();
+	const char *p = list;
+	while (*p && *p != '\n') {
+		int first, last, n;
+		if (sscanf(p, "%d%n", &first, &n) != 1)
+			return false;
+		p += n;
+		last = first;
+		if (*p == '-') {
+			if (sscanf(p + 1, "%d%n", &last, &n) != 1 || last < first)
+				return false;
+			p += 1 + n;
+		}
+		for (int c = first; c <= last; c++)
+			cpus.push_back(c);
+		if (*p == ',')
+			p++;
+	}
+	return true;
+}
+
+static bool read_sys_line(const std::string &path, std::string &line)
+{
+	FILE *fp = fopen(path.c_str(), "r");
+	if (!fp)
+		return false;
+	char buf[4096];
+	bool ok = fgets(buf, sizeof(buf), fp) != NULL;
+	fclose(fp);
+	if (ok)
+		line = buf;
+	return ok;
+}
+
+static int read_sys_int(const std::string &path, int fallback)
+{
+	std::string line;
+	int value;
+	if (!read_sys_line(path, line) || sscanf(line.c_str(), "%d", &value) != 1)
+		return fallback;
+	return value;
+}
+
+struct CpuInfo
+{
+	int cpu;
+	int package;
+	int core;
+	int node;
+	bool first_sibling;	// lowest numbered SMT thread of its core
+};
+
+class Placement
+{
+private:
+	std::vector<CpuInfo> d_cpus;	// selected CPUs
+	std::vector<std::vector<int> > d_groups;	// selected CPUs per node
+	std::vector<int> d_group_node;
+	int d_nodes;
+	int d_packages;
+	int d_cores;
+	int d_online;
+
+public:
+	Placement(): d_nodes(1), d_packages(1), d_cores(0), d_online(0) {
+		d_groups.resize(1);
+		d_group_node.push_back(-1);
+	}
+
+	/*
+	 * Read the topology and select CPUs: those in cpu_list (all
+	 * online CPUs if empty) that the process may run on, with only
+	 * one thread per core if no_smt is set.
+	 */
+	bool init(const char *cpu_list, bool no_smt) {
+#ifndef __linux__
+		printf("Placement: CPU topology is only read on Linux\n");
+		return false;
+#else
+		const std::string sys = "/sys/devices/system/";
+		std::string line;
+		std::vector<int> online, wanted, node_cpus;
+		if (!read_sys_line(sys + "cpu/online", line) || !parse_cpu_list(line.c_str(), online)) {
+			printf("Placement: could not read the online CPUs\n");
+			return false;
+		}
+		d_online = (int)online.size();
+		if (cpu_list[0] && !parse_cpu_list(cpu_list, wanted)) {
+			printf("Placement: bad CPU list \"%s\"\n", cpu_list);
+			return false;
+		}
+		cpu_set_t allowed;
+		bool have_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+		//node of every CPU, 0 on kernels without NUMA
+		std::vector<int> cpu_node(online.back() + 1, 0);
+		int max_node = 0;
+		for (int n = 0; n < 1024; n++) {
+			char name[64];
+			sprintf(name, "node/node%d/cpulist", n);
+			if (!read_sys_line(sys + name, line))
+				continue;
+			parse_cpu_list(line.c_str(), node_cpus);
+			for (size_t k = 0; k < node_cpus.size(); k++)
+				if (node_cpus[k] < (int)cpu_node.size())
+					cpu_node[node_cpus[k]] = n;
+			max_node = n;
+		}
+
+		std::vector<std::pair<int, int> > cores;
+		std::vector<int> packages;
+		for (size_t k = 0; k < online.size(); k++) {
+			CpuInfo info;
+			char dir[64];
+			sprintf(dir, "cpu/cpu%d/topology/", online[k]);
+			info.cpu = online[k];
+			info.package = read_sys_int(sys + dir + "physical_package_id", 0);
+			info.core = read_sys_int(sys + dir + "core_id", info.cpu);
+			info.node = cpu_node[info.cpu];
+			std::vector<int> siblings;
+			if (read_sys_line(sys + dir + "thread_siblings_list", line) &&
+			    parse_cpu_list(line.c_str(), siblings) && !siblings.empty())
+				info.first_sibling = siblings[0] == info.cpu;
+			else
+				info.first_sibling = true;
+
+			std::pair<int, int> core(info.package, info.core);
+			if (std::find(cores.begin(), cores.end(), core) == cores.end())
+				cores.push_back(core);
+			if (std::find(packages.begin(), packages.end(), info.package) == packages.end())
+				packages.push_back(info.package);
+
+			if (!wanted.empty() && std::find(wanted.begin(), wanted.end(), info.cpu) == wanted.end())
+				continue;
+			if (have_mask && info.cpu < CPU_SETSIZE && !CPU_ISSET(info.cpu, &allowed))
+				continue;
+			if (no_smt && !info.first_sibling)
+				continue;
+			d_cpus.push_back(info);
+		}
+		d_cores = (int)cores.size();
+		d_packages = (int)packages.size();
+		if (d_cpus.empty()) {
+			printf("Placement: no usable CPU selected\n");
+			return false;
+		}
+
+		//one group per node that has selected CPUs
+		d_groups.clear();
+		d_group_node.clear();
+		for (int n = 0; n <= max_node; n++) {
+			std::vector<int> group;
+			for (size_t k = 0; k < d_cpus.size(); k++)
+				if (d_cpus[k].node == n)
+					group.push_back(d_cpus[k].cpu);
+			if (!group.empty()) {
+				d_groups.push_back(group);
+				d_group_node.push_back(n);
+			}
+		}
+		d_nodes = max_node + 1;
+		return true;
+#endif
+	}
+
+	int groups() const { return (int)d_groups.size(); }
+	//NUMA node of a group, -1 when unknown
+	int group_node(int g) const { return d_group_node[g]; }
+	//CPUs of a group, empty when unpinned
+	const std::vector<int> &group_cpus(int g) const { return d_groups[g]; }
+
+	void report() const {
+		printf("Placement: %d online CPUs, %d cores, %d packages, %d NUMA nodes\n",
+		       d_online, d_cores, d_packages, d_nodes);
+		for (int g = 0; g < groups(); g++) {
+			printf("Placement: node %d runs on CPUs", d_group_node[g]);
+			for (size_t k = 0; k < d_groups[g].size(); k++)
+				printf(" %d", d_groups[g][k]);
+			printf("\n");
+		}
+	}
+
+	/*
+	 * Restrict the calling thread to all selected CPUs. Threads it
+	 * creates afterwards, libavcodec's included, inherit the mask.
+	 */
+	bool pin_process() const {
+		std::vector<int> all;
+		for (size_t k = 0; k < d_cpus.size(); k++)
+			all.push_back(d_cpus[k].cpu);
+		return pin_thread(all);
+	}
+
+	//restrict the calling thread to cpus
+	static bool pin_thread(const std::vector<int> &cpus) {
+#ifdef __linux__
+		if (cpus.empty())
+			return true;
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (size_t k = 0; k < cpus.size(); k++)
+			if (cpus[k] < CPU_SETSIZE)
+				CPU_SET(cpus[k], &set);
+		return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+		return cpus.empty();
+#endif
+	}
+};
+
+#endif
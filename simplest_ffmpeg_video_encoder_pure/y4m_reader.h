@@ -0,0 +1,154 @@
+/**
+ * YUV4MPEG2 (.y4m) input
+ *
+ * Included after the FFmpeg headers. The same header is kept in both
+ * encoder projects.
+ *
+ * A .y4m file is a text header line followed by frames, each a
+ * "FRAME" line and the raw planes, packed:
+ *
+ * 	YUV4MPEG2 W1280 H720 F25:1 Ip A1:1 C420jpeg\n
+ * 	FRAME\n <planes> FRAME\n <planes> ...
+ *
+ * 	W, H	frame size
+ * 	F	frame rate as a fraction, 25:1 if absent
+ * 	I	interlacing: p(rogressive), t(op first), b(ottom first), m(ixed)
+ * 	A	sample aspect ratio, 0:0 for unknown
+ * 	C	colorspace, 420jpeg if absent
+ *
+ * So the geometry and timing come from the file instead of being
+ * compiled in, and the end of the file ends the input.
+ */
+
+#ifndef Y4M_READER_H
+#define Y4M_READER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Y4MInfo {
+	int width;
+	int height;
+	AVRational fps;			// frames per second
+	AVRational sar;			// 0:1 when unknown
+	enum AVPixelFormat pix_fmt;
+	char interlace;			// 'p', 't', 'b', 'm' or '?'
+	int header_size;		// bytes up to and including the header's newline
+} Y4MInfo;
+
+//nonzero if path names a .y4m file
+static int y4m_is_y4m(const char *path)
+{
+	size_t len = strlen(path);
+	return len > 4 && (!strcmp(path + len - 4, ".y4m") || !strcmp(path + len - 4, ".Y4M"));
+}
+
+static enum AVPixelFormat y4m_pix_fmt(const char *colorspace)
+{
+	static const struct {
+		const char *name;
+		enum AVPixelFormat pix_fmt;
+	} map[] = {
+		{ "420jpeg",  AV_PIX_FMT_YUV420P },
+		{ "420paldv", AV_PIX_FMT_YUV420P },
+		{ "420mpeg2", AV_PIX_FMT_YUV420P },
+		{ "420",      AV_PIX_FMT_YUV420P },
+		{ "422",      AV_PIX_FMT_YUV422P },
+		{ "444",      AV_PIX_FMT_YUV444P },
+		{ "mono",     AV_PIX_FMT_GRAY8 },
+		{ "420p10",   AV_PIX_FMT_YUV420P10LE },
+		{ "422p10",   AV_PIX_FMT_YUV422P10LE },
+		{ "444p10",   AV_PIX_FMT_YUV444P10LE },
+	};
+	for (size_t k = 0; k < sizeof(map) / sizeof(map[0]); k++)
+		if (!strcmp(colorspace, map[k].name))
+			return map[k].pix_fmt;
+	return AV_PIX_FMT_NONE;
+}
+
+/*
+ * Parse the stream header at the current position of fp.
+ * Returns 0 on success, -1 if it is not a usable y4m header.
+ */
+static int y4m_read_header(FILE *fp, Y4MInfo *info)
+{
+	char line[1024];
+	int len = 0;
+	int c;
+	while ((c = fgetc(fp)) != EOF && c != '\n') {
+		if (len == (int)sizeof(line) - 1)
+			return -1;
+		line[len++] = (char)c;
+	}
+	line[len] = 0;
+	if (c != '\n' || strncmp(line, "YUV4MPEG2 ", 10))
+		return -1;
+
+	info->width = info->height = 0;
+	info->fps.num = 25;
+	info->fps.den = 1;
+	info->sar.num = 0;
+	info->sar.den = 1;
+	info->pix_fmt = AV_PIX_FMT_YUV420P;
+	info->interlace = '?';
+	info->header_size = len + 1;
+
+	for (char *tok = strtok(line + 10, " "); tok; tok = strtok(NULL, " ")) {
+		switch (tok[0]) {
+		case 'W': info->width = atoi(tok + 1); break;
+		case 'H': info->height = atoi(tok + 1); break;
+		case 'F':
+			if (sscanf(tok + 1, "%d:%d", &info->fps.num, &info->fps.den) != 2 ||
+			    info->fps.num <= 0 || info->fps.den <= 0)
+				return -1;
+			break;
+		case 'A':
+			if (sscanf(tok + 1, "%d:%d", &info->sar.num, &info->sar.den) != 2 || info->sar.den <= 0) {
+				info->sar.num = 0;
+				info->sar.den = 1;
+			}
+			break;
+		case 'I': info->interlace = tok[1]; break;
+		case 'C':
+			info->pix_fmt = y4m_pix_fmt(tok + 1);
+			if (info->pix_fmt == AV_PIX_FMT_NONE) {
+				printf("Unsupported y4m colorspace %s\n", tok + 1);
+				return -1;
+			}
+			break;
+		default: break;	// X extensions and unknown tags
+		}
+	}
+	return info->width > 0 && info->height > 0 ? 0 : -1;
+}
+
+/*
+ * Consume the "FRAME" line in front of the next frame.
+ * Returns 0 on success, -1 at the end of the input or on a bad marker.
+ */
+static int y4m_read_frame_header(FILE *fp)
+{
+	char tag[5];
+	int c;
+	if (fread(tag, 1, 5, fp) != 5 || memcmp(tag, "FRAME", 5))
+		return -1;
+	//frame parameters, if any, are ignored
+	while ((c = fgetc(fp)) != EOF && c != '\n')
+		;
+	return c == '\n' ? 0 : -1;
+}
+
+//bytes of the planes of one frame
+static int y4m_frame_size(const Y4MInfo *info)
+{
+	return avpicture_get_size(info->pix_fmt, info->width, info->height);
+}
+
+//file offset of frame index, assuming bare "FRAME\n" markers as all common writers emit
+static long long y4m_frame_offset(const Y4MInfo *info, int index)
+{
+	return info->header_size + (long long)index * (6 + y4m_frame_size(info));
+}
+
+#endif